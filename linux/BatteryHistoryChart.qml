@@ -0,0 +1,63 @@
+import QtQuick 2.15
+
+// Battery levels over the last hours, one line per component
+Canvas {
+    id: root
+    property var history
+    property int hours: 24
+    // Battery::Component values and their line colors
+    property var components: [
+        { component: 4, color: "#4caf50" },  // Left
+        { component: 2, color: "#2196f3" },  // Right
+        { component: 8, color: "#ff9800" }   // Case
+    ]
+
+    height: 80
+
+    Connections {
+        target: root.history
+        function onRecorded() { repaintTimer.restart() }
+    }
+
+    // Battery packets arrive in bursts, one repaint covers them all
+    Timer {
+        id: repaintTimer
+        interval: 1000
+        onTriggered: root.requestPaint()
+    }
+
+    onWidthChanged: requestPaint()
+    onVisibleChanged: if (visible) requestPaint()
+
+    onPaint: {
+        var ctx = getContext("2d")
+        ctx.clearRect(0, 0, width, height)
+        if (!history)
+            return
+
+        var now = Date.now()
+        var from = now - hours * 3600 * 1000
+        ctx.strokeStyle = "#40ffffff"
+        ctx.lineWidth = 1
+        ctx.strokeRect(0.5, 0.5, width - 1, height - 1)
+
+        for (var c = 0; c < components.length; c++) {
+            // One point per two pixels is as much as the line can show
+            var points = history.query(components[c].component, from, now, Math.max(3, Math.floor(width / 2)))
+            if (points.length < 2)
+                continue
+            ctx.strokeStyle = components[c].color
+            ctx.lineWidth = 1.5
+            ctx.beginPath()
+            for (var i = 0; i < points.length; i++) {
+                var x = (points[i].x - from) / (now - from) * width
+                var y = height - points[i].y / 100 * height
+                if (i === 0)
+                    ctx.moveTo(x, y)
+                else
+                    ctx.lineTo(x, y)
+            }
+            ctx.stroke()
+        }
+    }
+}
@@ -105,10 +105,10 @@ bool BluetoothMonitor::checkAlreadyConnectedDevices()
                 bool connected = deviceProps["Connected"].toBool();
                 if (connected)
                 {
-                    QString macAddress = deviceProps["Address"].toString();
+                    BluetoothAddress address = BluetoothAddress::fromString(deviceProps["Address"].toString());
                     QString deviceName = deviceProps["Name"].toString();
-                    emit deviceConnected(macAddress, deviceName);
-                    LOG_DEBUG("Found already connected AirPods: " << macAddress << " Name: " << deviceName);
+                    emit deviceConnected(address, deviceName);
+                    LOG_DEBUG("Found already connected AirPods: " << address << " Name: " << deviceName);
                     deviceFound = true;
                 }
             }
@@ -136,26 +136,23 @@ void BluetoothMonitor::onPropertiesChanged(const QString &interface, const QVari
             return;
         }
 
-        QDBusInterface deviceInterface("org.bluez", path, "org.freedesktop.DBus.Properties", m_dbus);
-
-        // Get the device address
-        QDBusReply<QVariant> addrReply = deviceInterface.call("Get", "org.bluez.Device1", "Address");
-        if (!addrReply.isValid())
+        // The object path ends in dev_AA_BB_CC_DD_EE_FF, no need to ask BlueZ for the Address property
+        BluetoothAddress address = BluetoothAddress::fromDevicePath(path);
+        if (address.isNull())
         {
             return;
         }
-        QString macAddress = addrReply.value().toString();
         QString deviceName = getDeviceName(path);
 
         if (connected)
         {
-            emit deviceConnected(macAddress, deviceName);
-            LOG_DEBUG("AirPods device connected:" << macAddress << " Name:" << deviceName);
+            emit deviceConnected(address, deviceName);
+            LOG_DEBUG("AirPods device connected:" << address << " Name:" << deviceName);
         }
         else
         {
-            emit deviceDisconnected(macAddress, deviceName);
-            LOG_DEBUG("AirPods device disconnected:" << macAddress << " Name:" << deviceName);
+            emit deviceDisconnected(address, deviceName);
+            LOG_DEBUG("AirPods device disconnected:" << address << " Name:" << deviceName);
         }
     }
 }
\ No newline at end of file
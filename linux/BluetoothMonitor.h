@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QtDBus/QtDBus>
+#include "bluetoothaddress.h"
 
 // Forward declarations for D-Bus types
 typedef QMap<QDBusObjectPath, QMap<QString, QVariantMap>> ManagedObjectList;
@@ -18,8 +19,8 @@ public:
     bool checkAlreadyConnectedDevices();
 
 signals:
-    void deviceConnected(const QString &macAddress, const QString &deviceName);
-    void deviceDisconnected(const QString &macAddress, const QString &deviceName);
+    void deviceConnected(BluetoothAddress address, const QString &deviceName);
+    void deviceDisconnected(BluetoothAddress address, const QString &deviceName);
 
 private slots:
     void onPropertiesChanged(const QString &interface, const QVariantMap &changedProps, const QStringList &invalidatedProps);
@@ -0,0 +1,78 @@
+import QtQuick 2.15
+
+// Live head orientation, one line per axis. The view holds a head tracking
+// subscription only while it is shown, so the AirPods stream nothing otherwise.
+Canvas {
+    id: root
+    property var manager
+    // Sensor packets come much faster than the chart needs to redraw
+    property int decimation: 4
+    property int maxSamples: 100
+    property var colors: ["#ff00ff", "#00ff00", "#ffa500"]
+    property var subscription: null
+    property var samples: []
+    readonly property bool shown: visible && Window.visibility !== Window.Hidden
+
+    height: 80
+
+    function updateSubscription() {
+        if (shown && manager && !subscription) {
+            subscription = manager.subscribe("qml", decimation)
+        } else if (!(shown && manager) && subscription) {
+            subscription.release()
+            subscription = null
+            samples = []
+        }
+    }
+
+    onShownChanged: updateSubscription()
+    onManagerChanged: updateSubscription()
+    Component.onCompleted: updateSubscription()
+    Component.onDestruction: if (subscription) subscription.release()
+
+    Connections {
+        target: root.subscription
+        function onSampleReceived(sample) {
+            root.samples.push([sample.orientation1, sample.orientation2, sample.orientation3])
+            if (root.samples.length > root.maxSamples)
+                root.samples.shift()
+            root.requestPaint()
+        }
+    }
+
+    onPaint: {
+        var ctx = getContext("2d")
+        ctx.clearRect(0, 0, width, height)
+        ctx.strokeStyle = "#40ffffff"
+        ctx.lineWidth = 1
+        ctx.strokeRect(0.5, 0.5, width - 1, height - 1)
+        if (samples.length < 2)
+            return
+
+        // Raw values have no fixed range, scale to what is on screen
+        var min = samples[0][0]
+        var max = min
+        for (var i = 0; i < samples.length; i++) {
+            for (var a = 0; a < 3; a++) {
+                min = Math.min(min, samples[i][a])
+                max = Math.max(max, samples[i][a])
+            }
+        }
+        var range = Math.max(1, max - min)
+
+        for (var axis = 0; axis < 3; axis++) {
+            ctx.strokeStyle = colors[axis]
+            ctx.lineWidth = 1.5
+            ctx.beginPath()
+            for (var j = 0; j < samples.length; j++) {
+                var x = j / (maxSamples - 1) * width
+                var y = height - (samples[j][axis] - min) / range * height
+                if (j === 0)
+                    ctx.moveTo(x, y)
+                else
+                    ctx.lineTo(x, y)
+            }
+            ctx.stroke()
+        }
+    }
+}
@@ -88,6 +88,42 @@ ApplicationWindow {
                     }
                 }
 
+                // AirPods advertising nearby while none is connected
+                Column {
+                    anchors.horizontalCenter: parent.horizontalCenter
+                    spacing: 4
+                    visible: !airPodsTrayApp.airpodsConnected && airPodsTrayApp.nearbyDevices.count > 0
+
+                    Label {
+                        text: "Nearby AirPods"
+                        font.pixelSize: 12
+                        opacity: 0.7
+                    }
+
+                    Repeater {
+                        model: airPodsTrayApp.nearbyDevices
+
+                        Row {
+                            spacing: 8
+
+                            Image {
+                                source: "qrc:/icons/assets/" + icon
+                                width: 24
+                                height: 24
+                                fillMode: Image.PreserveAspectFit
+                            }
+
+                            Label {
+                                anchors.verticalCenter: parent.verticalCenter
+                                text: model.model + (pairingMode ? "  (pairing)" : "") + (leftBattery >= 0 ? "  L " + leftBattery + "%" : "")
+                                      + (rightBattery >= 0 ? "  R " + rightBattery + "%" : "")
+                                      + (caseBattery >= 0 ? "  Case " + caseBattery + "%" : "")
+                                      + "  " + rssi + " dBm"
+                            }
+                        }
+                    }
+                }
+
                 // Battery Indicator Row
                 Row {
                     anchors.horizontalCenter: parent.horizontalCenter
@@ -128,12 +164,29 @@ ApplicationWindow {
                     }
                 }
 
+                Label {
+                    anchors.horizontalCenter: parent.horizontalCenter
+                    text: airPodsTrayApp.deviceInfo.batteryEstimate
+                    visible: text !== ""
+                    font.pixelSize: 12
+                    opacity: 0.7
+                }
+
+                BatteryHistoryChart {
+                    anchors.horizontalCenter: parent.horizontalCenter
+                    width: 320
+                    visible: airPodsTrayApp.airpodsConnected
+                    history: airPodsTrayApp.batteryHistory
+                }
+
                 SegmentedControl {
                     anchors.horizontalCenter: parent.horizontalCenter
-                    model: ["Off", "Noise Cancellation", "Transparency", "Adaptive"]
+                    model: airPodsTrayApp.deviceInfo.adaptiveModeSupported
+                           ? ["Off", "Noise Cancellation", "Transparency", "Adaptive"]
+                           : ["Off", "Noise Cancellation", "Transparency"]
                     currentIndex: airPodsTrayApp.deviceInfo.noiseControlMode
                     onCurrentIndexChanged: airPodsTrayApp.setNoiseControlModeInt(currentIndex)
-                    visible: airPodsTrayApp.airpodsConnected
+                    visible: airPodsTrayApp.airpodsConnected && airPodsTrayApp.deviceInfo.noiseCancellationSupported
                 }
 
                 Slider {
@@ -160,17 +213,31 @@ ApplicationWindow {
 
                 Switch {
                     visible: airPodsTrayApp.airpodsConnected
+                             && airPodsTrayApp.deviceInfo.conversationalAwarenessSupported
                     text: "Conversational Awareness"
                     checked: airPodsTrayApp.deviceInfo.conversationalAwareness
                     onCheckedChanged: airPodsTrayApp.setConversationalAwareness(checked)
                 }
 
                 Switch {
-                    visible: airPodsTrayApp.airpodsConnected
+                    visible: airPodsTrayApp.airpodsConnected && airPodsTrayApp.deviceInfo.hearingAidSupported
                     text: "Hearing Aid"
                     checked: airPodsTrayApp.deviceInfo.hearingAidEnabled
                     onCheckedChanged: airPodsTrayApp.setHearingAidEnabled(checked)
                 }
+
+                Switch {
+                    id: headTrackingSwitch
+                    visible: airPodsTrayApp.airpodsConnected && airPodsTrayApp.deviceInfo.headTrackingSupported
+                    text: "Head Tracking"
+                }
+
+                HeadTrackingView {
+                    anchors.horizontalCenter: parent.horizontalCenter
+                    width: 320
+                    visible: headTrackingSwitch.visible && headTrackingSwitch.checked
+                    manager: airPodsTrayApp.headTracking
+                }
             }
 
             RoundButton {
@@ -242,7 +309,7 @@ ApplicationWindow {
                     }
 
                     Switch {
-                        visible: airPodsTrayApp.airpodsConnected
+                        visible: airPodsTrayApp.airpodsConnected && airPodsTrayApp.deviceInfo.oneBudANCSupported
                         text: "One Bud ANC Mode"
                         checked: airPodsTrayApp.deviceInfo.oneBudANCMode
                         onCheckedChanged: airPodsTrayApp.deviceInfo.oneBudANCMode = checked
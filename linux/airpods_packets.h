@@ -238,6 +238,20 @@ namespace AirPodsPackets
         }
     }
 
+    // Head Tracking
+    namespace HeadTracking
+    {
+        static const QByteArray START = QByteArray::fromHex("04000400170000001000100008A102420B080E10021A0501409C0000");
+        static const QByteArray STOP = QByteArray::fromHex("040004001700000010001100087E1002420B084E10021A050100000000");
+        static const QByteArray HEADER = QByteArray::fromHex("04000400170000001000");
+        static constexpr int MIN_SENSOR_PACKET_SIZE = 80;
+
+        inline bool isSensorPacket(const QByteArray &data)
+        {
+            return data.size() >= MIN_SENSOR_PACKET_SIZE && data.startsWith(HEADER);
+        }
+    }
+
     // Parsing Headers
     namespace Parse
     {
@@ -1,9 +1,10 @@
 #pragma once
 
 #include <QByteArray>
-#include <QMap>
 #include <QString>
 #include <QObject>
+#include <algorithm>
+#include <array>
 #include <climits>
 
 #include "airpods_packets.h"
@@ -13,18 +14,18 @@ class Battery : public QObject
 {
     Q_OBJECT
 
-    Q_PROPERTY(quint8 leftPodLevel READ getLeftPodLevel NOTIFY batteryStatusChanged)
-    Q_PROPERTY(bool leftPodCharging READ isLeftPodCharging NOTIFY batteryStatusChanged)
-    Q_PROPERTY(bool leftPodAvailable READ isLeftPodAvailable NOTIFY batteryStatusChanged)
-    Q_PROPERTY(quint8 rightPodLevel READ getRightPodLevel NOTIFY batteryStatusChanged)
-    Q_PROPERTY(bool rightPodCharging READ isRightPodCharging NOTIFY batteryStatusChanged)
-    Q_PROPERTY(bool rightPodAvailable READ isRightPodAvailable NOTIFY batteryStatusChanged)
-    Q_PROPERTY(quint8 headsetLevel READ getHeadsetLevel NOTIFY batteryStatusChanged)
-    Q_PROPERTY(bool headsetCharging READ isHeadsetCharging NOTIFY batteryStatusChanged)
-    Q_PROPERTY(bool headsetAvailable READ isHeadsetAvailable NOTIFY batteryStatusChanged)
-    Q_PROPERTY(quint8 caseLevel READ getCaseLevel NOTIFY batteryStatusChanged)
-    Q_PROPERTY(bool caseCharging READ isCaseCharging NOTIFY batteryStatusChanged)
-    Q_PROPERTY(bool caseAvailable READ isCaseAvailable NOTIFY batteryStatusChanged)
+    Q_PROPERTY(quint8 leftPodLevel READ getLeftPodLevel NOTIFY leftPodChanged)
+    Q_PROPERTY(bool leftPodCharging READ isLeftPodCharging NOTIFY leftPodChanged)
+    Q_PROPERTY(bool leftPodAvailable READ isLeftPodAvailable NOTIFY leftPodChanged)
+    Q_PROPERTY(quint8 rightPodLevel READ getRightPodLevel NOTIFY rightPodChanged)
+    Q_PROPERTY(bool rightPodCharging READ isRightPodCharging NOTIFY rightPodChanged)
+    Q_PROPERTY(bool rightPodAvailable READ isRightPodAvailable NOTIFY rightPodChanged)
+    Q_PROPERTY(quint8 headsetLevel READ getHeadsetLevel NOTIFY headsetChanged)
+    Q_PROPERTY(bool headsetCharging READ isHeadsetCharging NOTIFY headsetChanged)
+    Q_PROPERTY(bool headsetAvailable READ isHeadsetAvailable NOTIFY headsetChanged)
+    Q_PROPERTY(quint8 caseLevel READ getCaseLevel NOTIFY caseChanged)
+    Q_PROPERTY(bool caseCharging READ isCaseCharging NOTIFY caseChanged)
+    Q_PROPERTY(bool caseAvailable READ isCaseAvailable NOTIFY caseChanged)
 
 public:
     explicit Battery(QObject *parent = nullptr) : QObject(parent)
@@ -35,11 +36,8 @@ public:
     void reset()
     {
         // Initialize all components to unknown state
-        states[Component::Headset] = {};
-        states[Component::Left] = {};
-        states[Component::Right] = {};
-        states[Component::Case] = {};
-        emit batteryStatusChanged();
+        States cleared{};
+        commit(cleared, primaryPod);
     }
 
     // Enum for AirPods components
@@ -65,8 +63,36 @@ public:
     {
         quint8 level = 0; // Battery level (0-100), 0 if unknown
         BatteryStatus status = BatteryStatus::Disconnected;
+
+        bool operator==(const BatteryState &other) const { return level == other.level && status == other.status; }
+        bool operator!=(const BatteryState &other) const { return !(*this == other); }
     };
 
+    static constexpr int COMPONENT_COUNT = 4;
+
+    // A set of Component bits, e.g. the components changed by the last packet
+    using ChangeMask = quint8;
+
+    // States of all components, indexed by componentIndex()
+    using States = std::array<BatteryState, COMPONENT_COUNT>;
+
+    // Position of a component in the state array, -1 for values not in the enum
+    static constexpr int componentIndex(Component component)
+    {
+        switch (component)
+        {
+        case Component::Headset:
+            return 0;
+        case Component::Right:
+            return 1;
+        case Component::Left:
+            return 2;
+        case Component::Case:
+            return 3;
+        }
+        return -1;
+    }
+
     // Parse the battery status packet and detect primary/secondary pods
     bool parsePacket(const QByteArray &packet)
     {
@@ -82,11 +108,11 @@ public:
             return false; // Invalid count or size mismatch
         }
 
-        QMap<Component, BatteryState> newStates = states;
+        States newStates = states;
 
         // Track pods to determine primary and secondary based on order
-        QList<Component> podsInPacket;
-        podsInPacket.reserve(2);
+        Component podsInPacket[3];
+        int podCount = 0;
 
         for (quint8 i = 0; i < batteryCount; ++i)
         {
@@ -101,47 +127,34 @@ public:
             }
 
             Component comp = static_cast<Component>(type);
+            int index = componentIndex(comp);
+            if (index < 0)
+            {
+                continue; // Not a component we track
+            }
             auto level = static_cast<quint8>(packet[offset + 2]);
             auto status = static_cast<BatteryStatus>(packet[offset + 3]);
 
             if (status != BatteryStatus::Disconnected)
             {
-                newStates[comp] = {level, status};
+                newStates[index] = {level, status};
             }
 
             // If this is a pod (Left or Right), add it to the list
             if (comp == Component::Left || comp == Component::Right || comp == Component::Headset)
             {
-                podsInPacket.append(comp);
+                podsInPacket[podCount++] = comp;
             }
         }
 
-        // Update states
-        states = newStates;
-
-        // Set primary and secondary pods based on order
-        if (!podsInPacket.isEmpty())
-        {
-            if (podsInPacket.count() == 1 && podsInPacket[0] == Component::Headset) {
-                // AirPods Max
-                primaryPod = podsInPacket[0];
-                emit primaryChanged();
-            } else {
-                Component newPrimaryPod = podsInPacket[0]; // First pod is primary
-                if (newPrimaryPod != primaryPod)
-                {
-                    primaryPod = newPrimaryPod;
-                    emit primaryChanged();
-                }
-            }
-        }
-        if (podsInPacket.size() >= 2)
+        // Set primary and secondary pods based on order; the first pod is primary
+        Component newPrimaryPod = podCount > 0 ? podsInPacket[0] : primaryPod;
+        if (podCount >= 2)
         {
             secondaryPod = podsInPacket[1]; // Second pod is secondary
         }
 
-        // Emit signal to notify about battery status change
-        emit batteryStatusChanged();
+        commit(newStates, newPrimaryPod);
 
         if (primaryPod == Component::Headset) {
             LOG_INFO("Primary Pod:" << primaryPod);
@@ -166,6 +179,9 @@ public:
         int leftByteIndex = isLeftPodPrimary ? 1 : 2;
         int rightByteIndex = isLeftPodPrimary ? 2 : 1;
 
+        States newStates = states;
+        Component newPrimaryPod = primaryPod;
+
         // Extract raw battery bytes
         unsigned char rawLeftBatteryByte = static_cast<unsigned char>(packet.at(leftByteIndex));
         unsigned char rawRightBatteryByte = static_cast<unsigned char>(packet.at(rightByteIndex));
@@ -183,44 +199,49 @@ public:
             if (it != std::end(batteries)) {
                 std::size_t idx = it - std::begin(batteries);
                 int battery = *it;
-                primaryPod = Component::Headset;
-                states[Component::Headset] =  {static_cast<quint8>(battery), statuses[idx] ? BatteryStatus::Charging : BatteryStatus::Discharging};
+                newPrimaryPod = Component::Headset;
+                newStates[componentIndex(Component::Headset)] = {static_cast<quint8>(battery), statuses[idx] ? BatteryStatus::Charging : BatteryStatus::Discharging};
             }
         } else {
+            const BatteryState &left = stateOf(Component::Left);
+            const BatteryState &right = stateOf(Component::Right);
+            const BatteryState &caseState = stateOf(Component::Case);
+
             if (rawLeftBattery == CHAR_MAX) {
-                rawLeftBattery = states.value(Component::Left).level; // Use last valid level
-                isLeftCharging = states.value(Component::Left).status == BatteryStatus::Charging;
+                rawLeftBattery = left.level; // Use last valid level
+                isLeftCharging = left.status == BatteryStatus::Charging;
             }
 
             if (rawRightBattery == CHAR_MAX) {
-                rawRightBattery = states.value(Component::Right).level; // Use last valid level
-                isRightCharging = states.value(Component::Right).status == BatteryStatus::Charging;
+                rawRightBattery = right.level; // Use last valid level
+                isRightCharging = right.status == BatteryStatus::Charging;
             }
 
             if (rawCaseBattery == CHAR_MAX) {
-                rawCaseBattery = states.value(Component::Case).level; // Use last valid level
-                isCaseCharging = states.value(Component::Case).status == BatteryStatus::Charging;
+                rawCaseBattery = caseState.level; // Use last valid level
+                isCaseCharging = caseState.status == BatteryStatus::Charging;
             }
 
             // Update states
-            states[Component::Left] = {static_cast<quint8>(rawLeftBattery), isLeftCharging ? BatteryStatus::Charging : BatteryStatus::Discharging};
-            states[Component::Right] = {static_cast<quint8>(rawRightBattery), isRightCharging ? BatteryStatus::Charging : BatteryStatus::Discharging};
+            newStates[componentIndex(Component::Left)] = {static_cast<quint8>(rawLeftBattery), isLeftCharging ? BatteryStatus::Charging : BatteryStatus::Discharging};
+            newStates[componentIndex(Component::Right)] = {static_cast<quint8>(rawRightBattery), isRightCharging ? BatteryStatus::Charging : BatteryStatus::Discharging};
             if (podInCase) {
-                states[Component::Case] = {static_cast<quint8>(rawCaseBattery), isCaseCharging ? BatteryStatus::Charging : BatteryStatus::Discharging};
+                newStates[componentIndex(Component::Case)] = {static_cast<quint8>(rawCaseBattery), isCaseCharging ? BatteryStatus::Charging : BatteryStatus::Discharging};
             }
-            primaryPod = isLeftPodPrimary ? Component::Left : Component::Right;
+            newPrimaryPod = isLeftPodPrimary ? Component::Left : Component::Right;
             secondaryPod = isLeftPodPrimary ? Component::Right : Component::Left;
         }
-        emit batteryStatusChanged();
-        emit primaryChanged();
 
+        // The same payload is advertised many times a second, only notify bindings of what changed
+        commit(newStates, newPrimaryPod);
         return true;
     }
 
     // Get the raw state for a component
     BatteryState getState(Component comp) const
     {
-        return states.value(comp, {});
+        int index = componentIndex(comp);
+        return index < 0 ? BatteryState() : states[index];
     }
 
     // Get a formatted status string including charging state
@@ -251,30 +272,99 @@ public:
         return QString("%1% (%2)").arg(state.level).arg(statusStr);
     }
 
+    const States &componentStates() const { return states; }
+
+    // Replaces every component at once, e.g. from a DeviceState snapshot
+    void setComponentStates(const States &newStates, Component newPrimaryPod)
+    {
+        commit(newStates, newPrimaryPod);
+    }
+
     Component getPrimaryPod() const { return primaryPod; }
     Component getSecondaryPod() const { return secondaryPod; }
+    // Components whose state changed in the last parsed packet
+    ChangeMask lastChangeMask() const { return m_lastChangeMask; }
+    quint64 skippedNotifications() const { return m_skippedNotifications; }
 
-    quint8 getLeftPodLevel() const { return states.value(Component::Left).level; }
+    quint8 getLeftPodLevel() const { return stateOf(Component::Left).level; }
     bool isLeftPodCharging() const { return isStatus(Component::Left, BatteryStatus::Charging); }
     bool isLeftPodAvailable() const { return !isStatus(Component::Left, BatteryStatus::Disconnected); }
-    quint8 getRightPodLevel() const { return states.value(Component::Right).level; }
+    quint8 getRightPodLevel() const { return stateOf(Component::Right).level; }
     bool isRightPodCharging() const { return isStatus(Component::Right, BatteryStatus::Charging); }
     bool isRightPodAvailable() const { return !isStatus(Component::Right, BatteryStatus::Disconnected); }
-    quint8 getCaseLevel() const { return states.value(Component::Case).level; }
+    quint8 getCaseLevel() const { return stateOf(Component::Case).level; }
     bool isCaseCharging() const { return isStatus(Component::Case, BatteryStatus::Charging); }
     bool isCaseAvailable() const { return !isStatus(Component::Case, BatteryStatus::Disconnected); }
-    quint8 getHeadsetLevel() const { return states.value(Component::Headset).level; }
+    quint8 getHeadsetLevel() const { return stateOf(Component::Headset).level; }
     bool isHeadsetCharging() const { return isStatus(Component::Headset, BatteryStatus::Charging); }
     bool isHeadsetAvailable() const { return !isStatus(Component::Headset, BatteryStatus::Disconnected); }
 
 signals:
+    // Emitted once per packet that changed any component, after the per-component signals
     void batteryStatusChanged();
     void primaryChanged();
+    void leftPodChanged();
+    void rightPodChanged();
+    void headsetChanged();
+    void caseChanged();
 
 private:
+    const BatteryState &stateOf(Component component) const { return states[componentIndex(component)]; }
+
     bool isStatus(Component component, BatteryStatus status) const
     {
-        return states.value(component).status == status;
+        return stateOf(component).status == status;
+    }
+
+    // Stores the new states and emits signals only for what differs from the current ones
+    void commit(const States &newStates, Component newPrimaryPod)
+    {
+        ChangeMask mask = 0;
+        for (Component component : {Component::Headset, Component::Right, Component::Left, Component::Case})
+        {
+            int index = componentIndex(component);
+            if (states[index] != newStates[index])
+            {
+                mask |= static_cast<ChangeMask>(component);
+            }
+        }
+        const bool primaryPodChanged = newPrimaryPod != primaryPod;
+
+        states = newStates;
+        primaryPod = newPrimaryPod;
+        m_lastChangeMask = mask;
+
+        // Each unchanged component is a group of bindings QML no longer re-evaluates
+        const std::pair<Component, void (Battery::*)()> notifiers[] = {
+            {Component::Left, &Battery::leftPodChanged},
+            {Component::Right, &Battery::rightPodChanged},
+            {Component::Headset, &Battery::headsetChanged},
+            {Component::Case, &Battery::caseChanged},
+        };
+        for (const auto &[component, notify] : notifiers)
+        {
+            if (mask & static_cast<ChangeMask>(component))
+            {
+                emit (this->*notify)();
+            }
+            else
+            {
+                m_skippedNotifications++;
+            }
+        }
+
+        if (mask)
+        {
+            emit batteryStatusChanged();
+        }
+        if (primaryPodChanged)
+        {
+            emit primaryChanged();
+        }
+        else
+        {
+            m_skippedNotifications++;
+        }
     }
 
     std::pair<bool, int> formatBattery(unsigned char byteVal)
@@ -284,7 +374,9 @@ private:
         return std::make_pair(charging, level);
     }
 
-    QMap<Component, BatteryState> states;
-    Component primaryPod;
-    Component secondaryPod;
+    States states{};
+    Component primaryPod = Component::Left;
+    Component secondaryPod = Component::Right;
+    ChangeMask m_lastChangeMask = 0;
+    quint64 m_skippedNotifications = 0; // Change signals not emitted because nothing changed
 };
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+#include <cmath>
+#include "battery.hpp"
+#include "enums.h"
+
+/**
+ * @brief Estimates time left and time to full from battery level steps.
+ *
+ * Keeps an exponentially weighted average of the discharge rate per component,
+ * noise control mode and media playback, and of the charge rate per component.
+ * Rates are measured between two level steps, so the 1% (AAP) and 10% (advert)
+ * granularity does not skew them. Every sample is O(1) on fixed arrays.
+ */
+class BatteryPredictor
+{
+public:
+    static constexpr double ALPHA = 0.3; // Weight of the newest rate
+    // A longer silence means the component was away, e.g. in a closed case
+    static constexpr qint64 MAX_GAP_MS = 90 * 60 * 1000;
+    static constexpr int MODE_COUNT = static_cast<int>(AirpodsTrayApp::Enums::NoiseControlMode::MaxValue) + 1;
+    static constexpr int CONTEXT_COUNT = MODE_COUNT * 2; // Noise control mode x media playing
+
+    void addSample(Battery::Component component, quint8 level, bool charging, qint64 timestampMs,
+                   AirpodsTrayApp::Enums::NoiseControlMode mode, bool playing)
+    {
+        const int index = Battery::componentIndex(component);
+        if (index < 0)
+        {
+            return;
+        }
+        Anchor &anchor = m_anchors[index];
+        const int context = contextIndex(mode, playing);
+        const Anchor next{timestampMs, level, charging, context, true, true};
+
+        if (!anchor.valid || anchor.charging != charging || timestampMs <= anchor.timestampMs
+            || timestampMs - anchor.timestampMs > MAX_GAP_MS || (!charging && anchor.context != context))
+        {
+            // Start over; the time already spent at this level is unknown
+            anchor = next;
+            anchor.aligned = false;
+            return;
+        }
+        if (level == anchor.level)
+        {
+            return;
+        }
+
+        if (anchor.aligned)
+        {
+            const double minutes = (timestampMs - anchor.timestampMs) / 60000.0;
+            if (charging && level > anchor.level)
+            {
+                m_charge[index].add((level - anchor.level) / minutes);
+            }
+            else if (!charging && level < anchor.level)
+            {
+                const double rate = (anchor.level - level) / minutes;
+                m_discharge[index][context].add(rate);
+                m_dischargeAnyContext[index].add(rate);
+            }
+        }
+        anchor = next;
+    }
+
+    // Forgets where each component was, keeping the learned rates
+    void resetAnchors() { m_anchors = {}; }
+
+    // Minutes until empty at the current level, -1 while unknown
+    int minutesRemaining(Battery::Component component, quint8 level, AirpodsTrayApp::Enums::NoiseControlMode mode,
+                         bool playing) const
+    {
+        const int index = Battery::componentIndex(component);
+        if (index < 0)
+        {
+            return -1;
+        }
+        const Rate &rate = m_discharge[index][contextIndex(mode, playing)];
+        return minutesFor(level, rate.valid ? rate : m_dischargeAnyContext[index]);
+    }
+
+    // Minutes until fully charged, -1 while unknown
+    int minutesToFull(Battery::Component component, quint8 level) const
+    {
+        const int index = Battery::componentIndex(component);
+        if (index < 0)
+        {
+            return -1;
+        }
+        return level >= 100 ? 0 : minutesFor(100 - level, m_charge[index]);
+    }
+
+private:
+    struct Rate
+    {
+        double percentPerMinute = 0;
+        bool valid = false;
+
+        void add(double sample)
+        {
+            percentPerMinute = valid ? percentPerMinute + ALPHA * (sample - percentPerMinute) : sample;
+            valid = true;
+        }
+    };
+
+    struct Anchor
+    {
+        qint64 timestampMs = 0;
+        quint8 level = 0;
+        bool charging = false;
+        int context = 0;
+        bool valid = false;
+        bool aligned = false; // Taken at a level step rather than at some point within a level
+    };
+
+    static int contextIndex(AirpodsTrayApp::Enums::NoiseControlMode mode, bool playing)
+    {
+        const int modeIndex = qBound(0, static_cast<int>(mode), MODE_COUNT - 1);
+        return modeIndex * 2 + (playing ? 1 : 0);
+    }
+
+    static int minutesFor(int percent, const Rate &rate)
+    {
+        if (!rate.valid || rate.percentPerMinute <= 0)
+        {
+            return -1;
+        }
+        return static_cast<int>(std::lround(percent / rate.percentPerMinute));
+    }
+
+    std::array<std::array<Rate, CONTEXT_COUNT>, Battery::COMPONENT_COUNT> m_discharge{};
+    std::array<Rate, Battery::COMPONENT_COUNT> m_dischargeAnyContext{}; // Fallback for contexts not seen yet
+    std::array<Rate, Battery::COMPONENT_COUNT> m_charge{};
+    std::array<Anchor, Battery::COMPONENT_COUNT> m_anchors{};
+};
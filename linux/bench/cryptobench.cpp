@@ -0,0 +1,136 @@
+// Microbenchmark for the BLE crypto paths: per-call key schedule with the
+// legacy AES API against the persistent EVP contexts in blecrypto.h.
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/aes.h>
+#include "../ble/blecrypto.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+constexpr int ITERATIONS = 200000;
+
+const quint8 IRK[16] = {0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+const quint8 ENC_KEY[16] = {0xf0, 0xe1, 0xd2, 0xc3, 0xb4, 0xa5, 0x96, 0x87, 0x78, 0x69, 0x5a, 0x4b, 0x3c, 0x2d, 0x1e, 0x0f};
+
+// The pre-EVP BLEUtils::ah(), reversed temporaries included
+bool legacyVerify(quint64 address, const QByteArray &irk)
+{
+    QByteArray reversedKey(irk);
+    std::reverse(reversedKey.begin(), reversedKey.end());
+    QByteArray padded(16, 0);
+    padded[0] = static_cast<char>(address >> 24);
+    padded[1] = static_cast<char>(address >> 32);
+    padded[2] = static_cast<char>(address >> 40);
+    std::reverse(padded.begin(), padded.end());
+
+    AES_KEY aesKey;
+    AES_set_encrypt_key(reinterpret_cast<const unsigned char *>(reversedKey.constData()), 128, &aesKey);
+    unsigned char out[16];
+    AES_encrypt(reinterpret_cast<const unsigned char *>(padded.constData()), out, &aesKey);
+    QByteArray result(reinterpret_cast<char *>(out), 16);
+    std::reverse(result.begin(), result.end());
+
+    return static_cast<quint8>(result[0]) == static_cast<quint8>(address)
+        && static_cast<quint8>(result[1]) == static_cast<quint8>(address >> 8)
+        && static_cast<quint8>(result[2]) == static_cast<quint8>(address >> 16);
+}
+
+// The pre-EVP BLEUtils::decryptLastBytes()
+QByteArray legacyDecrypt(const QByteArray &data, const QByteArray &key)
+{
+    QByteArray block = data.right(16);
+    AES_KEY aesKey;
+    AES_set_decrypt_key(reinterpret_cast<const unsigned char *>(key.constData()), 128, &aesKey);
+    unsigned char out[16];
+    unsigned char iv[16];
+    memset(iv, 0, 16);
+    AES_cbc_encrypt(reinterpret_cast<const unsigned char *>(block.constData()), out, 16, &aesKey, iv, AES_DECRYPT);
+    return QByteArray(reinterpret_cast<char *>(out), 16);
+}
+
+void report(const char *name, qint64 nsecs)
+{
+    double opsPerSec = nsecs > 0 ? ITERATIONS * 1e9 / nsecs : 0.0;
+    std::printf("%-34s %12.0f ops/s\n", name, opsPerSec);
+}
+} // namespace
+
+int main()
+{
+    const QByteArray irk(reinterpret_cast<const char *>(IRK), 16);
+    const QByteArray encKey(reinterpret_cast<const char *>(ENC_KEY), 16);
+    IrkContext irkContext(irk);
+    EncKeyContext encKeyContext(encKey);
+
+    // Cross-check both paths before timing them
+    for (quint64 address = 0x4a0000000000ULL; address < 0x4a0000000000ULL + 4096; address += 37)
+    {
+        if (legacyVerify(address, irk) != irkContext.verify(BluetoothAddress(address)))
+        {
+            std::fprintf(stderr, "RPA mismatch at %012llx\n", static_cast<unsigned long long>(address));
+            return 1;
+        }
+    }
+    quint8 payload[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        payload[i] = static_cast<quint8>(i * 11);
+    }
+    quint8 plain[16];
+    const QByteArray payloadBytes(reinterpret_cast<const char *>(payload), 16);
+    if (!encKeyContext.decrypt(payload, plain) || legacyDecrypt(payloadBytes, encKey) != QByteArray(reinterpret_cast<char *>(plain), 16))
+    {
+        std::fprintf(stderr, "Payload decryption mismatch\n");
+        return 1;
+    }
+
+    volatile int sink = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        sink += legacyVerify(0x4a0000000000ULL + i, irk);
+    }
+    report("RPA verify (AES_set_encrypt_key)", timer.nsecsElapsed());
+
+    timer.restart();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        sink += irkContext.verify(BluetoothAddress(0x4a0000000000ULL + i));
+    }
+    report("RPA verify (IrkContext)", timer.nsecsElapsed());
+
+    timer.restart();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        payload[0] = static_cast<quint8>(i);
+        sink += legacyDecrypt(QByteArray(reinterpret_cast<const char *>(payload), 16), encKey).size();
+    }
+    report("Payload decrypt (AES_set_decrypt_key)", timer.nsecsElapsed());
+
+    timer.restart();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        payload[0] = static_cast<quint8>(i * 7); // Mostly distinct blocks
+        sink += encKeyContext.decrypt(payload, plain);
+    }
+    report("Payload decrypt (EncKeyContext)", timer.nsecsElapsed());
+
+    timer.restart();
+    payload[0] = 0x42;
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        sink += encKeyContext.decrypt(payload, plain); // Unchanged payload between state changes
+    }
+    report("Payload decrypt (memoized)", timer.nsecsElapsed());
+
+    const EncKeyContext::Stats &stats = encKeyContext.stats();
+    std::printf("Payload memo: %llu hits, %llu misses\n", static_cast<unsigned long long>(stats.hits),
+                static_cast<unsigned long long>(stats.misses));
+    return sink == -1;
+}
@@ -0,0 +1,253 @@
+// End-to-end check of the AdvertisementMonitor1 backend against a mock
+// bluetoothd. A worker thread owns org.bluez on the session bus and serves an
+// adapter with AdvertisementMonitorManager1 plus one Device1. Once the monitor
+// registers, the mock reads its Patterns back through GetManagedObjects, reports
+// the device with DeviceFound and then pushes ManufacturerData changes as
+// PropertiesChanged signals. Exits non-zero unless every advert arrives intact
+// and exactly once.
+//
+// Needs its own session bus: dbus-run-session -- librepods-monitorcheck
+#include "BluetoothMonitor.h"
+#include "ble/advertisementmonitor.h"
+#include "ble/bleinfo.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+#include <cstdio>
+
+Q_LOGGING_CATEGORY(librepods, "librepods")
+
+using ManufacturerDataMap = QMap<quint16, QDBusVariant>; // a{qv}, keyed by company id
+Q_DECLARE_METATYPE(ManufacturerDataMap)
+
+namespace
+{
+constexpr const char *ADAPTER_PATH = "/org/bluez/hci0";
+constexpr const char *DEVICE_PATH = "/org/bluez/hci0/dev_4A_11_22_33_44_55";
+constexpr BluetoothAddress DEVICE_ADDRESS = BluetoothAddress::fromString("4A:11:22:33:44:55");
+
+QByteArray payload(int sequence)
+{
+    // Proximity Pairing header followed by a counter, enough to tell adverts apart
+    QByteArray data = QByteArray::fromHex("0719010e2055aa");
+    data.append(static_cast<char>(sequence & 0xff));
+    data.append(static_cast<char>(sequence >> 8));
+    return data;
+}
+
+QVariantMap deviceProperties(int sequence)
+{
+    ManufacturerDataMap manufacturerData;
+    manufacturerData.insert(BleInfo::APPLE_MANUFACTURER_ID, QDBusVariant(payload(sequence)));
+    // RSSI travels with every payload, as bluetoothd sends both from the same advert
+    return {{"RSSI", QVariant::fromValue<qint16>(-52)}, {"ManufacturerData", QVariant::fromValue(manufacturerData)}};
+}
+
+class MockObjectManager : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.DBus.ObjectManager")
+
+public:
+    using QObject::QObject;
+
+public slots:
+    ManagedObjectList GetManagedObjects()
+    {
+        ManagedObjectList objects;
+        objects[QDBusObjectPath(ADAPTER_PATH)].insert("org.bluez.AdvertisementMonitorManager1", QVariantMap());
+        return objects;
+    }
+};
+
+class MockDevice : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.bluez.Device1")
+    Q_PROPERTY(QString Address READ address)
+    Q_PROPERTY(qint16 RSSI READ rssi)
+    Q_PROPERTY(ManufacturerDataMap ManufacturerData READ manufacturerData)
+
+public:
+    using QObject::QObject;
+
+    QString address() const { return DEVICE_ADDRESS.toString(); }
+    qint16 rssi() const { return -52; }
+    ManufacturerDataMap manufacturerData() const
+    {
+        return deviceProperties(0).value("ManufacturerData").value<ManufacturerDataMap>();
+    }
+};
+
+class MockMonitorManager : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.bluez.AdvertisementMonitorManager1")
+
+public:
+    MockMonitorManager(const QDBusConnection &bus, int adverts) : m_bus(bus), m_adverts(adverts) {}
+
+    std::atomic<bool> patternsOk{false};
+
+public slots:
+    void RegisterMonitor(const QDBusObjectPath &root)
+    {
+        // Reply first, then call back like bluetoothd does
+        const QString client = message().service();
+        QTimer::singleShot(0, this, [this, client, root]() { readMonitors(client, root.path()); });
+    }
+
+    void UnregisterMonitor(const QDBusObjectPath &root) { Q_UNUSED(root); }
+
+private:
+    void readMonitors(const QString &client, const QString &root)
+    {
+        QDBusMessage call = QDBusMessage::createMethodCall(client, root, "org.freedesktop.DBus.ObjectManager",
+                                                           "GetManagedObjects");
+        auto *watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(call), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, client](QDBusPendingCallWatcher *watcher)
+        {
+            QDBusPendingReply<ManagedObjectList> reply = *watcher;
+            watcher->deleteLater();
+            if (reply.isError())
+            {
+                std::fprintf(stderr, "GetManagedObjects failed: %s\n", qPrintable(reply.error().message()));
+                return;
+            }
+            const ManagedObjectList objects = reply.value();
+            for (auto it = objects.constBegin(); it != objects.constEnd(); ++it)
+            {
+                const QVariantMap props = it.value().value("org.bluez.AdvertisementMonitor1");
+                QList<AdvertisementPattern> patterns;
+                props.value("Patterns").value<QDBusArgument>() >> patterns;
+                const QList<AdvertisementPattern> expected = AdvertisementMonitor::patterns();
+                patternsOk = props.value("Type").toString() == "or_patterns" && patterns.size() == expected.size()
+                             && patterns.value(0).adType == expected[0].adType
+                             && patterns.value(0).content == expected[0].content;
+                found(client, it.key().path());
+            }
+        });
+    }
+
+    void found(const QString &client, const QString &monitor)
+    {
+        QDBusMessage activate = QDBusMessage::createMethodCall(client, monitor, "org.bluez.AdvertisementMonitor1",
+                                                               "Activate");
+        m_bus.asyncCall(activate);
+        QDBusMessage deviceFound = QDBusMessage::createMethodCall(client, monitor, "org.bluez.AdvertisementMonitor1",
+                                                                  "DeviceFound");
+        deviceFound << QVariant::fromValue(QDBusObjectPath(DEVICE_PATH));
+        auto *watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(deviceFound), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *watcher)
+        {
+            watcher->deleteLater();
+            // The monitor subscribes to the device inside DeviceFound, so later signals reach it
+            for (int i = 1; i <= m_adverts; ++i)
+            {
+                QDBusMessage changed = QDBusMessage::createSignal(DEVICE_PATH, "org.freedesktop.DBus.Properties",
+                                                                 "PropertiesChanged");
+                changed << QStringLiteral("org.bluez.Device1") << deviceProperties(i) << QStringList();
+                m_bus.send(changed);
+            }
+        });
+    }
+
+    QDBusConnection m_bus;
+    int m_adverts;
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    qDBusRegisterMetaType<ManufacturerDataMap>();
+    qDBusRegisterMetaType<ManagedObjectList>();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Check the BlueZ advertisement monitor backend against a mock bluetoothd");
+    parser.addHelpOption();
+    QCommandLineOption advertsOption("adverts", "PropertiesChanged signals to send", "count", "1000");
+    parser.addOption(advertsOption);
+    parser.process(app);
+    const int adverts = qMax(1, parser.value(advertsOption).toInt());
+
+    // bluetoothd stand-in on its own connection and thread, like the real one in its own process
+    QThread mockThread;
+    QDBusConnection mockBus = QDBusConnection::connectToBus(QDBusConnection::SessionBus, "librepods-mock-bluez");
+    if (!mockBus.isConnected() || !mockBus.registerService("org.bluez"))
+    {
+        std::fprintf(stderr, "Cannot own org.bluez on the session bus, run under dbus-run-session\n");
+        return 1;
+    }
+    MockObjectManager objectManager;
+    MockMonitorManager manager(mockBus, adverts);
+    MockDevice device;
+    for (QObject *object : {static_cast<QObject *>(&objectManager), static_cast<QObject *>(&manager),
+                            static_cast<QObject *>(&device)})
+    {
+        object->moveToThread(&mockThread);
+    }
+    mockBus.registerObject("/", &objectManager, QDBusConnection::ExportAllSlots);
+    mockBus.registerObject(ADAPTER_PATH, &manager, QDBusConnection::ExportAllSlots);
+    mockBus.registerObject(DEVICE_PATH, &device, QDBusConnection::ExportAllProperties);
+    mockThread.start();
+
+    AdvertisementMonitor monitor(nullptr, QDBusConnection::sessionBus());
+    int received = 0;
+    int corrupt = 0;
+    QSet<int> sequences;
+    qint64 firstAdvertNs = -1;
+    QElapsedTimer timer;
+    QObject::connect(&monitor, &AdvertisementMonitor::failed, &app, [&app](const QString &error) {
+        std::fprintf(stderr, "Monitor failed: %s\n", qPrintable(error));
+        app.exit(1);
+    });
+    QObject::connect(&monitor, &AdvertisementMonitor::advertisement, &app,
+                     [&](BluetoothAddress address, int rssi, const QByteArray &data) {
+        if (firstAdvertNs < 0)
+        {
+            firstAdvertNs = timer.nsecsElapsed();
+        }
+        // Sequence 0 comes from GetAll, whose reply may overtake or trail the PropertiesChanged signals
+        const int sequence = data.size() >= 2 ? quint8(data[data.size() - 2]) | quint8(data[data.size() - 1]) << 8 : -1;
+        if (address != DEVICE_ADDRESS || rssi != -52 || data != payload(sequence) || sequence > adverts
+            || sequences.contains(sequence))
+        {
+            corrupt++;
+        }
+        sequences.insert(sequence);
+        if (++received == adverts + 1)
+        {
+            app.exit(0);
+        }
+    });
+
+    timer.start();
+    if (!monitor.start())
+    {
+        return 1;
+    }
+    QTimer::singleShot(10000, &app, [&app]() { app.exit(1); });
+    const int result = app.exec();
+    const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+    monitor.stop();
+
+    mockThread.quit();
+    mockThread.wait();
+
+    std::printf("Patterns:           %s\n", manager.patternsOk ? "as registered" : "WRONG");
+    std::printf("First advert after: %.3f ms\n", firstAdvertNs / 1e6);
+    std::printf("Adverts:            %d of %d received, %d corrupt\n", received, adverts + 1, corrupt);
+    std::printf("Throughput:         %.0f adverts/s\n", received / (elapsedNs / 1e9));
+
+    const bool ok = result == 0 && manager.patternsOk && received == adverts + 1 && corrupt == 0;
+    std::printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+#include "monitorcheck.moc"
@@ -0,0 +1,168 @@
+// Profile switch latency through an AudioBackend. Toggles a card between two
+// available profiles and reports how long the change takes to be acknowledged
+// (the future finishing) and to show up in the cached card (cardChanged with
+// the new active profile). Works on any card, e.g. the ALSA card of
+// `modprobe snd-dummy`; run once per backend against the same server.
+#include "media/audiobackend.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+Q_LOGGING_CATEGORY(librepods, "librepods")
+
+namespace
+{
+struct Samples
+{
+    std::vector<qint64> nanoseconds;
+
+    void print(const char *label)
+    {
+        if (nanoseconds.empty())
+        {
+            std::printf("%-12s no samples\n", label);
+            return;
+        }
+        std::sort(nanoseconds.begin(), nanoseconds.end());
+        const auto percentile = [this](double p) {
+            return nanoseconds[static_cast<size_t>(p * (nanoseconds.size() - 1))] / 1e6;
+        };
+        std::printf("%-12s p50 %8.3f ms   p90 %8.3f ms   max %8.3f ms\n", label, percentile(0.5), percentile(0.9),
+                    nanoseconds.back() / 1e6);
+    }
+};
+
+// Runs the event loop until done() holds or the timeout expires
+template <typename Done>
+bool waitFor(Done done, int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done())
+    {
+        if (timer.elapsed() > timeoutMs)
+        {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 10);
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure card profile switch latency of the audio backends");
+    parser.addHelpOption();
+    QCommandLineOption backendOption("backend", "pulse or pipewire", "name", "pulse");
+    QCommandLineOption iterationsOption("iterations", "Profile switches", "count", "50");
+    QCommandLineOption sinkOption("sink", "Also time volume changes on this sink, e.g. a null sink", "name");
+    parser.addOptions({backendOption, iterationsOption, sinkOption});
+    parser.addPositionalArgument("card", "Card to switch, as named by the server");
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+    {
+        parser.showHelp(1);
+    }
+    const QString cardName = parser.positionalArguments().first();
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+
+    qputenv("LIBREPODS_AUDIO_BACKEND", parser.value(backendOption).toUtf8());
+    AudioBackend *audio = AudioBackend::create(&app);
+    if (!audio->initialize() || !waitFor([audio]() { return audio->isReady(); }, 5000))
+    {
+        std::fprintf(stderr, "%s backend did not become ready\n", audio->name());
+        return 1;
+    }
+
+    const CardSnapshot card = audio->getCardSnapshot(cardName);
+    QStringList profiles;
+    for (const CardSnapshot::Profile &profile : card.profiles)
+    {
+        if (profile.available && profile.name != "off")
+        {
+            profiles << profile.name;
+        }
+    }
+    if (profiles.size() < 2)
+    {
+        std::fprintf(stderr, "Card %s needs two available profiles besides off\n", qPrintable(cardName));
+        return 1;
+    }
+
+    QString activeProfile = card.activeProfile;
+    QObject::connect(audio, &AudioBackend::cardChanged, &app, [&](const QString &changed) {
+        if (changed == cardName)
+        {
+            activeProfile = audio->getCardSnapshot(cardName).activeProfile;
+        }
+    });
+
+    Samples acknowledged;
+    Samples published;
+    int failures = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i)
+    {
+        const QString target = profiles[activeProfile == profiles[0] ? 1 : 0];
+        timer.start();
+        QFuture<bool> future = audio->setCardProfile(cardName, target);
+        qint64 acknowledgedAt = -1;
+        qint64 publishedAt = -1;
+        const bool done = waitFor(
+            [&]() {
+                if (acknowledgedAt < 0 && future.isFinished())
+                {
+                    acknowledgedAt = timer.nsecsElapsed();
+                }
+                if (publishedAt < 0 && activeProfile == target)
+                {
+                    publishedAt = timer.nsecsElapsed();
+                }
+                return acknowledgedAt >= 0 && publishedAt >= 0;
+            },
+            AudioBackend::DEFAULT_TIMEOUT_MS * 2);
+        if (!done || future.isCanceled() || !future.result())
+        {
+            failures++;
+            continue;
+        }
+        acknowledged.nanoseconds.push_back(acknowledgedAt);
+        published.nanoseconds.push_back(publishedAt);
+    }
+
+    Samples volume;
+    const QString sinkName = parser.value(sinkOption);
+    for (int i = 0; !sinkName.isEmpty() && i < iterations; ++i)
+    {
+        timer.start();
+        QFuture<bool> future = audio->setSinkVolume(sinkName, i % 2 ? 40 : 60);
+        if (!waitFor([&future]() { return future.isFinished(); }, AudioBackend::DEFAULT_TIMEOUT_MS * 2) ||
+            future.isCanceled() || !future.result())
+        {
+            failures++;
+            continue;
+        }
+        volume.nanoseconds.push_back(timer.nsecsElapsed());
+    }
+
+    std::printf("Backend:     %s\n", audio->name());
+    std::printf("Card:        %s (%s <-> %s)\n", qPrintable(cardName), qPrintable(profiles[0]), qPrintable(profiles[1]));
+    std::printf("Switches:    %d (%d failed)\n", iterations, failures);
+    acknowledged.print("Acknowledged");
+    published.print("Published");
+    if (!sinkName.isEmpty())
+    {
+        volume.print("Volume");
+    }
+    return failures == 0 ? 0 : 1;
+}
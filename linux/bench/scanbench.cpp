@@ -0,0 +1,186 @@
+// Replays a BLE advert capture (LIBREPODS_BLE_CAPTURE) through the scan path:
+// change suppression and decoding in BleScanner, then RPA resolution and
+// payload decryption in KnownDevices, batched per 16 ms of capture time like
+// BleManager does. Reports throughput, allocations per advert and cache hit rates.
+#include "ble/advertcapture.h"
+#include "ble/blemanager.h"
+#include "ble/blescanner.h"
+#include "ble/knowndevices.h"
+#include "deviceinfo.hpp"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+Q_LOGGING_CATEGORY(librepods, "librepods")
+
+namespace
+{
+std::atomic<quint64> g_allocations{0};
+} // namespace
+
+#ifdef __GLIBC__
+// Count at the malloc level: QArrayData and other Qt containers allocate with malloc/realloc
+// directly, which a replaced operator new would not see. operator new ends up here as well.
+extern "C"
+{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+}
+constexpr bool COUNTS_ALLOCATIONS = true;
+#else
+constexpr bool COUNTS_ALLOCATIONS = false;
+#endif
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QLoggingCategory::setFilterRules("librepods.debug=false\nlibrepods.info=false");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replay a BLE advert capture through the scan path");
+    parser.addHelpOption();
+    parser.addPositionalArgument("capture", "Capture file written with LIBREPODS_BLE_CAPTURE");
+    QCommandLineOption irkOption("irk", "Identity Resolving Key (hex), may be repeated", "hex");
+    QCommandLineOption encOption("enc", "Encryption key (hex) for the preceding --irk", "hex");
+    QCommandLineOption repeatOption("repeat", "Replay the capture this many times", "count", "1");
+    parser.addOptions({irkOption, encOption, repeatOption});
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+    {
+        parser.showHelp(1);
+    }
+
+    // Load the capture up front so file I/O is not measured
+    std::vector<CapturedAdvert> adverts;
+    AdvertCaptureReader reader;
+    if (!reader.open(parser.positionalArguments().constFirst()))
+    {
+        std::fprintf(stderr, "%s\n", qPrintable(reader.errorString()));
+        return 1;
+    }
+    CapturedAdvert advert;
+    while (reader.read(advert))
+    {
+        adverts.push_back(advert);
+    }
+    if (adverts.empty())
+    {
+        std::fprintf(stderr, "Capture is empty\n");
+        return 1;
+    }
+
+    DeviceInfo current;
+    KnownDevices knownDevices(&current);
+    const QStringList irks = parser.values(irkOption);
+    const QStringList encKeys = parser.values(encOption);
+    for (int i = 0; i < irks.size(); ++i)
+    {
+        current.setMagicAccIRK(QByteArray::fromHex(irks[i].toLatin1()));
+        current.setMagicAccEncKey(QByteArray::fromHex(encKeys.value(i).toLatin1()));
+        knownDevices.rememberCurrentDevice();
+    }
+
+    QVector<BleInfo> batch;
+    batch.reserve(BleManager::QUEUE_CAPACITY);
+    BleScanner scanner([&batch](const BleInfo &info)
+    {
+        if (batch.size() == BleManager::QUEUE_CAPACITY)
+        {
+            return false;
+        }
+        batch.append(info);
+        return true;
+    });
+
+    const int repeat = qMax(1, parser.value(repeatOption).toInt());
+    const qint64 captureSpanMs = adverts.back().timestampMs - adverts.front().timestampMs + 1;
+    quint64 replayed = 0;
+
+    const quint64 allocationsBefore = g_allocations.load();
+    QElapsedTimer timer;
+    timer.start();
+    for (int pass = 0; pass < repeat; ++pass)
+    {
+        // Shift every pass forward in time so the caches age as they would live
+        const qint64 offset = pass * captureSpanMs;
+        qint64 frameEnd = adverts.front().timestampMs + offset + BleManager::FRAME_INTERVAL_MS;
+        for (const CapturedAdvert &captured : adverts)
+        {
+            const qint64 now = captured.timestampMs + offset;
+            if (now >= frameEnd)
+            {
+                knownDevices.handleAdverts(batch);
+                batch.clear();
+                frameEnd = now + BleManager::FRAME_INTERVAL_MS;
+            }
+            scanner.processAdvert(captured.address, captured.rssi, captured.manufacturerData, now);
+            replayed++;
+        }
+        knownDevices.handleAdverts(batch);
+        batch.clear();
+    }
+    const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+    const quint64 allocations = g_allocations.load() - allocationsBefore;
+
+    const BleScanner::Stats stats = scanner.stats();
+    const RpaCache::Stats &rpa = knownDevices.resolverStats();
+    quint64 payloadHits = 0;
+    quint64 payloadMisses = 0;
+    for (DeviceInfo *device : knownDevices.devices())
+    {
+        payloadHits += device->encKeyContext().stats().hits;
+        payloadMisses += device->encKeyContext().stats().misses;
+    }
+    auto rate = [](quint64 hits, quint64 misses) { return hits + misses ? 100.0 * hits / (hits + misses) : 0.0; };
+
+    std::printf("Adverts replayed:      %llu (%zu per pass, %d passes)\n",
+                static_cast<unsigned long long>(replayed), adverts.size(), repeat);
+    std::printf("Throughput:            %.0f adverts/s\n", replayed * 1e9 / elapsedNs);
+    if (COUNTS_ALLOCATIONS)
+    {
+        std::printf("Allocations:           %.2f per advert (malloc, calloc and realloc calls)\n",
+                    static_cast<double>(allocations) / replayed);
+    }
+    std::printf("Suppressed unchanged:  %llu, heartbeats %llu, decoded %llu, dropped %llu\n",
+                static_cast<unsigned long long>(stats.suppressed), static_cast<unsigned long long>(stats.heartbeats),
+                static_cast<unsigned long long>(stats.emitted), static_cast<unsigned long long>(stats.dropped));
+    std::printf("RPA cache hit rate:    %.1f%% (%llu hits, %llu misses, %llu evictions)\n",
+                rate(rpa.hits, rpa.misses), static_cast<unsigned long long>(rpa.hits),
+                static_cast<unsigned long long>(rpa.misses), static_cast<unsigned long long>(rpa.evictions));
+    std::printf("Payload memo hit rate: %.1f%% (%llu hits, %llu decrypted)\n",
+                rate(payloadHits, payloadMisses), static_cast<unsigned long long>(payloadHits),
+                static_cast<unsigned long long>(payloadMisses));
+    return 0;
+}
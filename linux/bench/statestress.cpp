@@ -0,0 +1,140 @@
+// Stress check for the SeqLock behind DeviceInfo::snapshot(): writer threads
+// publish DeviceStates whose fields all derive from one counter while reader
+// threads check every snapshot for torn fields and for generations going
+// backwards. Exits non-zero on the first inconsistency.
+#include "devicestate.h"
+#include "seqlock.hpp"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+Q_LOGGING_CATEGORY(librepods, "librepods")
+
+namespace
+{
+using AirpodsTrayApp::Enums::NoiseControlMode;
+
+void fill(DeviceState &state, quint64 counter)
+{
+    const quint8 level = static_cast<quint8>(counter % 101);
+    for (Battery::BatteryState &component : state.battery)
+    {
+        component.level = level;
+        component.status = counter & 1 ? Battery::BatteryStatus::Charging : Battery::BatteryStatus::Discharging;
+    }
+    state.primaryPod = counter & 2 ? Battery::Component::Right : Battery::Component::Left;
+    state.noiseControlMode = static_cast<NoiseControlMode>(counter % 4);
+    state.address = BluetoothAddress(counter);
+    state.adaptiveNoiseLevel = static_cast<qint32>(counter % 101);
+    state.conversationalAwareness = counter & 1;
+}
+
+// True if every field was written from the same counter value
+bool consistent(const DeviceState &state)
+{
+    if (state.address.isNull())
+    {
+        return true; // Nothing published yet
+    }
+    DeviceState expected = state;
+    fill(expected, state.address.toUInt64());
+    return expected.battery == state.battery && expected.primaryPod == state.primaryPod &&
+           expected.noiseControlMode == state.noiseControlMode &&
+           expected.adaptiveNoiseLevel == state.adaptiveNoiseLevel &&
+           expected.conversationalAwareness == state.conversationalAwareness;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Check DeviceState snapshots under concurrent writers and readers");
+    parser.addHelpOption();
+    QCommandLineOption writersOption("writers", "Writer threads", "count", "2");
+    QCommandLineOption readersOption("readers", "Reader threads", "count", "4");
+    QCommandLineOption secondsOption("seconds", "Run time", "seconds", "2");
+    parser.addOptions({writersOption, readersOption, secondsOption});
+    parser.process(app);
+
+    const int writers = qMax(1, parser.value(writersOption).toInt());
+    const int readers = qMax(1, parser.value(readersOption).toInt());
+    const int seconds = qMax(1, parser.value(secondsOption).toInt());
+
+    SeqLock<DeviceState> state;
+    std::atomic<quint64> counter{0};
+    std::atomic<bool> stop{false};
+    std::atomic<quint64> writes{0};
+    std::atomic<quint64> reads{0};
+    std::atomic<quint64> torn{0};
+    std::atomic<quint64> backwards{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < writers; ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            quint64 published = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                const quint64 next = counter.fetch_add(1, std::memory_order_relaxed) + 1;
+                if (state.update([next](DeviceState &current) { fill(current, next); }))
+                {
+                    published++;
+                }
+            }
+            writes.fetch_add(published);
+        });
+    }
+    for (int i = 0; i < readers; ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            quint64 seen = 0;
+            quint64 lastGeneration = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                quint64 generation = 0;
+                const DeviceState snapshot = state.load(&generation);
+                if (!consistent(snapshot))
+                {
+                    torn.fetch_add(1);
+                }
+                if (generation < lastGeneration)
+                {
+                    backwards.fetch_add(1);
+                }
+                lastGeneration = generation;
+                seen++;
+            }
+            reads.fetch_add(seen);
+        });
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop.store(true);
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    const double elapsed = qMax<qint64>(1, timer.nsecsElapsed()) / 1e9;
+
+    std::printf("Threads:            %d writers, %d readers\n", writers, readers);
+    std::printf("Writes:             %.0f/s (%llu published, final generation %llu)\n", writes.load() / elapsed,
+                static_cast<unsigned long long>(writes.load()), static_cast<unsigned long long>(state.generation()));
+    std::printf("Reads:              %.0f/s\n", reads.load() / elapsed);
+    std::printf("Torn snapshots:     %llu\n", static_cast<unsigned long long>(torn.load()));
+    std::printf("Generation regress: %llu\n", static_cast<unsigned long long>(backwards.load()));
+
+    const bool ok = torn.load() == 0 && backwards.load() == 0 && state.generation() == writes.load();
+    std::printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#include "advertcapture.h"
+
+bool AdvertCaptureWriter::open(const QString &path)
+{
+    m_file.setFileName(path);
+    bool exists = m_file.exists() && m_file.size() > 0;
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_6_0);
+    if (!exists)
+    {
+        m_stream << MAGIC << VERSION;
+    }
+    return true;
+}
+
+void AdvertCaptureWriter::write(const CapturedAdvert &advert)
+{
+    if (!m_file.isOpen())
+    {
+        return;
+    }
+    m_stream << advert.timestampMs << advert.address.toUInt64() << advert.rssi << advert.manufacturerData;
+    // Keep the file usable if the app is killed mid-capture
+    if (++m_written % 64 == 0)
+    {
+        m_file.flush();
+    }
+}
+
+bool AdvertCaptureReader::open(const QString &path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    m_stream >> magic >> version;
+    if (magic != AdvertCaptureWriter::MAGIC || version != AdvertCaptureWriter::VERSION)
+    {
+        m_error = QString("Not a capture file (magic %1, version %2)").arg(magic, 0, 16).arg(version);
+        return false;
+    }
+    return true;
+}
+
+bool AdvertCaptureReader::read(CapturedAdvert &advert)
+{
+    if (m_stream.atEnd())
+    {
+        return false;
+    }
+    quint64 address = 0;
+    m_stream >> advert.timestampMs >> address >> advert.rssi >> advert.manufacturerData;
+    advert.address = BluetoothAddress(address);
+    return m_stream.status() == QDataStream::Ok;
+}
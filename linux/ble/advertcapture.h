@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QString>
+#include "bluetoothaddress.h"
+
+/**
+ * @brief One raw advert as seen by the scanner, before any filtering.
+ */
+struct CapturedAdvert
+{
+    qint64 timestampMs = 0;
+    BluetoothAddress address;
+    qint16 rssi = 0;
+    QByteArray manufacturerData; // Apple (0x004C) manufacturer specific data
+};
+
+/**
+ * @brief Appends adverts to a capture file for later replay (see bench/scanbench.cpp).
+ *
+ * Enabled in the app by setting LIBREPODS_BLE_CAPTURE to a file path.
+ */
+class AdvertCaptureWriter
+{
+public:
+    static constexpr quint32 MAGIC = 0x4C504243; // "LPBC"
+    static constexpr quint16 VERSION = 1;
+
+    bool open(const QString &path);
+    bool isOpen() const { return m_file.isOpen(); }
+    void write(const CapturedAdvert &advert);
+    quint64 written() const { return m_written; }
+
+private:
+    QFile m_file;
+    QDataStream m_stream;
+    quint64 m_written = 0;
+};
+
+class AdvertCaptureReader
+{
+public:
+    bool open(const QString &path);
+    bool read(CapturedAdvert &advert);
+    QString errorString() const { return m_error; }
+
+private:
+    QFile m_file;
+    QDataStream m_stream;
+    QString m_error;
+};
@@ -0,0 +1,286 @@
+#include "advertisementmonitor.h"
+#include "bleinfo.h"
+#include "BluetoothMonitor.h"
+#include "logger.h"
+
+namespace
+{
+// Serves GetManagedObjects on the root path so BlueZ can discover the monitor
+class AdvertisementMonitorRoot : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.DBus.ObjectManager")
+
+public:
+    using QObject::QObject;
+
+public slots:
+    ManagedObjectList GetManagedObjects()
+    {
+        QVariantMap props;
+        props.insert("Type", QStringLiteral("or_patterns"));
+        props.insert("Patterns", QVariant::fromValue(AdvertisementMonitor::patterns()));
+
+        ManagedObjectList objects;
+        objects[QDBusObjectPath(AdvertisementMonitor::MONITOR_PATH)].insert("org.bluez.AdvertisementMonitor1", props);
+        return objects;
+    }
+};
+} // namespace
+
+QDBusArgument &operator<<(QDBusArgument &argument, const AdvertisementPattern &pattern)
+{
+    argument.beginStructure();
+    argument << pattern.startPosition << pattern.adType << pattern.content;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, AdvertisementPattern &pattern)
+{
+    argument.beginStructure();
+    argument >> pattern.startPosition >> pattern.adType >> pattern.content;
+    argument.endStructure();
+    return argument;
+}
+
+AdvertisementMonitor::AdvertisementMonitor(QObject *parent, const QDBusConnection &bus)
+    : QObject(parent), m_dbus(bus)
+{
+    qDBusRegisterMetaType<AdvertisementPattern>();
+    qDBusRegisterMetaType<QList<AdvertisementPattern>>();
+    qDBusRegisterMetaType<ManagedObjectList>();
+}
+
+AdvertisementMonitor::~AdvertisementMonitor()
+{
+    stop();
+    if (m_exported)
+    {
+        m_dbus.unregisterObject(MONITOR_PATH);
+        m_dbus.unregisterObject(ROOT_PATH);
+    }
+}
+
+QList<AdvertisementPattern> AdvertisementMonitor::patterns()
+{
+    // Manufacturer specific data (0xff) starting with Apple's company id (little-endian) and type 0x07
+    const char content[] = {static_cast<char>(BleInfo::APPLE_MANUFACTURER_ID & 0xff),
+                            static_cast<char>(BleInfo::APPLE_MANUFACTURER_ID >> 8),
+                            static_cast<char>(BleInfo::PROXIMITY_PAIRING_TYPE)};
+    return {AdvertisementPattern{0, 0xff, QByteArray(content, sizeof(content))}};
+}
+
+bool AdvertisementMonitor::start()
+{
+    if (m_registered)
+    {
+        return true;
+    }
+    if (!m_dbus.isConnected())
+    {
+        emit failed("System D-Bus not available");
+        return false;
+    }
+
+    if (!m_exported)
+    {
+        m_root = new AdvertisementMonitorRoot(this);
+        if (!m_dbus.registerObject(ROOT_PATH, m_root, QDBusConnection::ExportAllSlots)
+            || !m_dbus.registerObject(MONITOR_PATH, this, QDBusConnection::ExportScriptableSlots | QDBusConnection::ExportScriptableProperties))
+        {
+            m_dbus.unregisterObject(ROOT_PATH);
+            emit failed("Could not export the monitor objects");
+            return false;
+        }
+        m_exported = true;
+    }
+
+    // Counts as scanning from now on, a failure will be reported asynchronously
+    m_registered = true;
+    if (!m_adapterLookupPending)
+    {
+        findAdapterPath();
+    }
+    return true;
+}
+
+void AdvertisementMonitor::registerMonitor()
+{
+    auto *watcher = new QDBusPendingCallWatcher(m_dbus.asyncCall(managerCall("RegisterMonitor")), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *watcher)
+    {
+        QDBusPendingReply<> reply = *watcher;
+        watcher->deleteLater();
+        if (reply.isError())
+        {
+            m_registered = false;
+            emit failed(reply.error().message());
+            return;
+        }
+        LOG_INFO("BLE advertisement monitor registered on " << m_adapterPath);
+    });
+}
+
+void AdvertisementMonitor::stop()
+{
+    if (!m_registered)
+    {
+        return;
+    }
+    m_registered = false;
+
+    // Without an adapter path the lookup is still pending and nothing was registered yet
+    if (!m_adapterPath.isEmpty())
+    {
+        m_dbus.asyncCall(managerCall("UnregisterMonitor"));
+        m_adapterPath.clear();
+    }
+
+    for (auto it = m_devices.constBegin(); it != m_devices.constEnd(); ++it)
+    {
+        m_dbus.disconnect("org.bluez", it.key(), "org.freedesktop.DBus.Properties", "PropertiesChanged",
+                          this, SLOT(onDevicePropertiesChanged(QString, QVariantMap, QStringList)));
+    }
+    m_devices.clear();
+}
+
+QDBusMessage AdvertisementMonitor::managerCall(const QString &method) const
+{
+    // Plain messages, a QDBusInterface would introspect the adapter synchronously first
+    QDBusMessage call = QDBusMessage::createMethodCall("org.bluez", m_adapterPath, "org.bluez.AdvertisementMonitorManager1", method);
+    call << QVariant::fromValue(QDBusObjectPath(ROOT_PATH));
+    return call;
+}
+
+void AdvertisementMonitor::Release()
+{
+    LOG_DEBUG("BLE advertisement monitor released by BlueZ");
+    m_registered = false;
+}
+
+void AdvertisementMonitor::Activate()
+{
+    LOG_DEBUG("BLE advertisement monitor activated");
+}
+
+void AdvertisementMonitor::DeviceFound(const QDBusObjectPath &device)
+{
+    const QString path = device.path();
+    if (!m_devices.contains(path))
+    {
+        // Later adverts of the device only update its properties
+        m_dbus.connect("org.bluez", path, "org.freedesktop.DBus.Properties", "PropertiesChanged",
+                       this, SLOT(onDevicePropertiesChanged(QString, QVariantMap, QStringList)));
+        // The object path already names the device, no need to wait for its Address property
+        TrackedDevice tracked;
+        tracked.address = BluetoothAddress::fromDevicePath(path);
+        m_devices.insert(path, tracked);
+    }
+
+    // Runs on the scanner thread, which must not wait for bluetoothd
+    QDBusMessage getAll = QDBusMessage::createMethodCall("org.bluez", path, "org.freedesktop.DBus.Properties", "GetAll");
+    getAll << QStringLiteral("org.bluez.Device1");
+    auto *watcher = new QDBusPendingCallWatcher(m_dbus.asyncCall(getAll), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, path](QDBusPendingCallWatcher *watcher)
+    {
+        QDBusPendingReply<QVariantMap> reply = *watcher;
+        watcher->deleteLater();
+        // Ignored if the device was lost or the monitor stopped in the meantime
+        if (!reply.isError())
+        {
+            handleDeviceProperties(path, reply.value());
+        }
+    });
+}
+
+void AdvertisementMonitor::DeviceLost(const QDBusObjectPath &device)
+{
+    const QString path = device.path();
+    if (m_devices.remove(path))
+    {
+        m_dbus.disconnect("org.bluez", path, "org.freedesktop.DBus.Properties", "PropertiesChanged",
+                          this, SLOT(onDevicePropertiesChanged(QString, QVariantMap, QStringList)));
+    }
+}
+
+void AdvertisementMonitor::onDevicePropertiesChanged(const QString &interface, const QVariantMap &changedProps, const QStringList &invalidatedProps)
+{
+    Q_UNUSED(invalidatedProps);
+
+    if (interface != "org.bluez.Device1")
+    {
+        return;
+    }
+    handleDeviceProperties(QDBusContext::message().path(), changedProps);
+}
+
+void AdvertisementMonitor::handleDeviceProperties(const QString &path, const QVariantMap &props)
+{
+    auto it = m_devices.find(path);
+    if (it == m_devices.end())
+    {
+        return;
+    }
+
+    if (props.contains("Address"))
+    {
+        it->address = BluetoothAddress::fromString(props.value("Address").toString());
+    }
+    if (props.contains("RSSI"))
+    {
+        it->rssi = props.value("RSSI").toInt();
+    }
+
+    // RSSI-only changes carry no new payload
+    if (!props.contains("ManufacturerData") || it->address.isNull())
+    {
+        return;
+    }
+    QByteArray data = appleManufacturerData(props.value("ManufacturerData"));
+    if (!data.isEmpty())
+    {
+        emit advertisement(it->address, it->rssi, data);
+    }
+}
+
+QByteArray AdvertisementMonitor::appleManufacturerData(const QVariant &value)
+{
+    // a{qv}, keyed by company id
+    QMap<quint16, QDBusVariant> manufacturerData;
+    value.value<QDBusArgument>() >> manufacturerData;
+    return manufacturerData.value(BleInfo::APPLE_MANUFACTURER_ID).variant().toByteArray();
+}
+
+void AdvertisementMonitor::findAdapterPath()
+{
+    // Asked again on every start, the adapter may have been replaced while stopped
+    m_adapterLookupPending = true;
+    QDBusMessage call = QDBusMessage::createMethodCall("org.bluez", "/", "org.freedesktop.DBus.ObjectManager", "GetManagedObjects");
+    auto *watcher = new QDBusPendingCallWatcher(m_dbus.asyncCall(call), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *watcher)
+    {
+        QDBusPendingReply<ManagedObjectList> reply = *watcher;
+        watcher->deleteLater();
+        m_adapterLookupPending = false;
+        if (!m_registered)
+        {
+            return; // Stopped in the meantime
+        }
+
+        const ManagedObjectList objects = reply.isError() ? ManagedObjectList() : reply.value();
+        for (auto it = objects.constBegin(); it != objects.constEnd(); ++it)
+        {
+            if (it.value().contains("org.bluez.AdvertisementMonitorManager1"))
+            {
+                m_adapterPath = it.key().path();
+                registerMonitor();
+                return;
+            }
+        }
+        m_registered = false;
+        emit failed("No adapter provides org.bluez.AdvertisementMonitorManager1");
+    });
+}
+
+#include "advertisementmonitor.moc"
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QtDBus/QtDBus>
+#include "bluetoothaddress.h"
+
+/**
+ * @brief One entry of the AdvertisementMonitor1 "Patterns" property, a(yyay) on the bus.
+ */
+struct AdvertisementPattern
+{
+    quint8 startPosition = 0;
+    quint8 adType = 0;
+    QByteArray content;
+};
+Q_DECLARE_METATYPE(AdvertisementPattern)
+
+QDBusArgument &operator<<(QDBusArgument &argument, const AdvertisementPattern &pattern);
+const QDBusArgument &operator>>(const QDBusArgument &argument, AdvertisementPattern &pattern);
+
+/**
+ * @brief Lets BlueZ (or the controller, when it supports offloading) filter adverts for us.
+ *
+ * Exports an org.bluez.AdvertisementMonitor1 with an or_patterns match on
+ * Apple manufacturer data of type 0x07 (Proximity Pairing) and registers it
+ * with the adapter's AdvertisementMonitorManager1. The process then only hears
+ * about devices that match, instead of every advert in range.
+ */
+class AdvertisementMonitor : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.bluez.AdvertisementMonitor1")
+    Q_PROPERTY(QString Type READ type)
+    Q_PROPERTY(QList<AdvertisementPattern> Patterns READ patterns)
+
+public:
+    static constexpr const char *ROOT_PATH = "/me/kavishdevar/librepods/advmon";
+    static constexpr const char *MONITOR_PATH = "/me/kavishdevar/librepods/advmon/proximity";
+
+    // The bus is only replaced by test harnesses that stand in for bluetoothd
+    explicit AdvertisementMonitor(QObject *parent = nullptr, const QDBusConnection &bus = QDBusConnection::systemBus());
+    ~AdvertisementMonitor();
+
+    // Registers the monitor; failed() is emitted if BlueZ does not support it
+    bool start();
+    void stop();
+    bool isActive() const { return m_registered; }
+
+    QString type() const { return QStringLiteral("or_patterns"); }
+    static QList<AdvertisementPattern> patterns();
+
+public slots:
+    // Called by BlueZ
+    Q_SCRIPTABLE void Release();
+    Q_SCRIPTABLE void Activate();
+    Q_SCRIPTABLE void DeviceFound(const QDBusObjectPath &device);
+    Q_SCRIPTABLE void DeviceLost(const QDBusObjectPath &device);
+
+signals:
+    void advertisement(BluetoothAddress address, int rssi, const QByteArray &manufacturerData);
+    void failed(const QString &error);
+
+private slots:
+    void onDevicePropertiesChanged(const QString &interface, const QVariantMap &changedProps, const QStringList &invalidatedProps);
+
+private:
+    struct TrackedDevice
+    {
+        BluetoothAddress address;
+        int rssi = 0;
+    };
+
+    void findAdapterPath();
+    void registerMonitor();
+    QDBusMessage managerCall(const QString &method) const;
+    void handleDeviceProperties(const QString &path, const QVariantMap &props);
+    static QByteArray appleManufacturerData(const QVariant &value);
+
+    QDBusConnection m_dbus;
+    QObject *m_root = nullptr;
+    QString m_adapterPath;
+    bool m_exported = false;
+    bool m_registered = false;
+    bool m_adapterLookupPending = false;
+    QHash<QString, TrackedDevice> m_devices; // Keyed by BlueZ device object path
+};
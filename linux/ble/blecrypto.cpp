@@ -0,0 +1,174 @@
+#include "blecrypto.h"
+#include <openssl/evp.h>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+AesContext::AesContext(const quint8 key[16], Direction direction)
+{
+    m_ctx = EVP_CIPHER_CTX_new();
+    if (!m_ctx)
+    {
+        return;
+    }
+
+    int enc = direction == Direction::Encrypt ? 1 : 0;
+    if (EVP_CipherInit_ex2(m_ctx, EVP_aes_128_ecb(), key, nullptr, enc, nullptr) != 1)
+    {
+        EVP_CIPHER_CTX_free(m_ctx);
+        m_ctx = nullptr;
+        return;
+    }
+    // Inputs are always whole blocks
+    EVP_CIPHER_CTX_set_padding(m_ctx, 0);
+}
+
+AesContext::~AesContext()
+{
+    EVP_CIPHER_CTX_free(m_ctx);
+}
+
+AesContext::AesContext(AesContext &&other) noexcept : m_ctx(other.m_ctx)
+{
+    other.m_ctx = nullptr;
+}
+
+AesContext &AesContext::operator=(AesContext &&other) noexcept
+{
+    if (this != &other)
+    {
+        EVP_CIPHER_CTX_free(m_ctx);
+        m_ctx = other.m_ctx;
+        other.m_ctx = nullptr;
+    }
+    return *this;
+}
+
+bool AesContext::process(const quint8 *in, quint8 *out, int blocks) const
+{
+    if (!m_ctx || blocks <= 0)
+    {
+        return false;
+    }
+
+    // ECB without padding keeps no state between calls, so the context is reused as is
+    int outLen = 0;
+    return EVP_CipherUpdate(m_ctx, out, &outLen, in, blocks * 16) == 1 && outLen == blocks * 16;
+}
+
+IrkContext::IrkContext(const QByteArray &irk)
+{
+    if (irk.size() != 16)
+    {
+        return;
+    }
+
+    quint8 reversedKey[16];
+    std::reverse_copy(irk.constBegin(), irk.constEnd(), reinterpret_cast<char *>(reversedKey));
+    m_aes = AesContext(reversedKey, AesContext::Direction::Encrypt);
+    m_id = qFromUnaligned<quint64>(irk.constData()) ^ qFromUnaligned<quint64>(irk.constData() + 8);
+}
+
+bool IrkContext::ah(const quint8 prand[3], quint8 hash[3]) const
+{
+    // e() works on byte-reversed data, so the padded prand lands at the end of the block
+    quint8 in[16] = {};
+    in[13] = prand[2];
+    in[14] = prand[1];
+    in[15] = prand[0];
+
+    quint8 out[16];
+    if (!m_aes.process(in, out, 1))
+    {
+        return false;
+    }
+
+    hash[0] = out[15];
+    hash[1] = out[14];
+    hash[2] = out[13];
+    return true;
+}
+
+bool IrkContext::verify(BluetoothAddress address) const
+{
+    // Least significant three bytes are the hash, the upper three the random part
+    const quint8 prand[3] = {address.byte(2), address.byte(1), address.byte(0)};
+
+    quint8 hash[3];
+    if (!ah(prand, hash))
+    {
+        return false;
+    }
+    return hash[0] == address.byte(5) && hash[1] == address.byte(4) && hash[2] == address.byte(3);
+}
+
+bool IrkContext::verifyBatch(const BluetoothAddress *addresses, int count, bool *results) const
+{
+    quint8 in[MAX_BATCH * 16];
+    quint8 out[MAX_BATCH * 16];
+
+    for (int start = 0; start < count; start += MAX_BATCH)
+    {
+        int blocks = qMin(MAX_BATCH, count - start);
+
+        // Same layout as ah(): the random part fills the end of each block
+        std::memset(in, 0, blocks * 16);
+        for (int i = 0; i < blocks; ++i)
+        {
+            BluetoothAddress address = addresses[start + i];
+            quint8 *block = in + i * 16;
+            block[13] = address.byte(0);
+            block[14] = address.byte(1);
+            block[15] = address.byte(2);
+        }
+
+        if (!m_aes.process(in, out, blocks))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < blocks; ++i)
+        {
+            BluetoothAddress address = addresses[start + i];
+            const quint8 *block = out + i * 16;
+            results[start + i] = block[15] == address.byte(5) && block[14] == address.byte(4) && block[13] == address.byte(3);
+        }
+    }
+    return true;
+}
+
+EncKeyContext::EncKeyContext(const QByteArray &key)
+{
+    if (key.size() != 16)
+    {
+        return;
+    }
+    // The payload key is used as is, no reversal
+    m_aes = AesContext(reinterpret_cast<const quint8 *>(key.constData()), AesContext::Direction::Decrypt);
+}
+
+bool EncKeyContext::decrypt(const quint8 ciphertext[BLOCK_SIZE], quint8 plaintext[BLOCK_SIZE])
+{
+    for (const CacheEntry &entry : m_cache)
+    {
+        if (entry.used && std::memcmp(entry.ciphertext, ciphertext, BLOCK_SIZE) == 0)
+        {
+            std::memcpy(plaintext, entry.plaintext, BLOCK_SIZE);
+            m_stats.hits++;
+            return true;
+        }
+    }
+
+    m_stats.misses++;
+    if (!m_aes.process(ciphertext, plaintext, 1))
+    {
+        return false;
+    }
+
+    CacheEntry &slot = m_cache[m_nextSlot];
+    m_nextSlot = (m_nextSlot + 1) % CACHE_SIZE;
+    std::memcpy(slot.ciphertext, ciphertext, BLOCK_SIZE);
+    std::memcpy(slot.plaintext, plaintext, BLOCK_SIZE);
+    slot.used = true;
+    return true;
+}
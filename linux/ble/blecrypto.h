@@ -0,0 +1,109 @@
+#pragma once
+
+#include <QByteArray>
+#include <QtGlobal>
+#include "bluetoothaddress.h"
+
+typedef struct evp_cipher_ctx_st EVP_CIPHER_CTX;
+
+/**
+ * @brief AES-128-ECB context with the key schedule computed once.
+ *
+ * Wraps an OpenSSL 3 EVP cipher context, which picks the AES-NI
+ * implementation when the CPU has it. Contexts are move-only and must not be
+ * shared between threads.
+ */
+class AesContext
+{
+public:
+    enum class Direction
+    {
+        Encrypt,
+        Decrypt
+    };
+
+    AesContext() = default;
+    AesContext(const quint8 key[16], Direction direction);
+    ~AesContext();
+
+    AesContext(AesContext &&other) noexcept;
+    AesContext &operator=(AesContext &&other) noexcept;
+    AesContext(const AesContext &) = delete;
+    AesContext &operator=(const AesContext &) = delete;
+
+    bool isValid() const { return m_ctx != nullptr; }
+
+    // Processes blocks * 16 bytes in one call so OpenSSL can pipeline them
+    bool process(const quint8 *in, quint8 *out, int blocks) const;
+
+private:
+    EVP_CIPHER_CTX *m_ctx = nullptr;
+};
+
+/**
+ * @brief Identity Resolving Key prepared for the Bluetooth ah() function.
+ */
+class IrkContext
+{
+public:
+    static constexpr int MAX_BATCH = 32; // Blocks per EVP call when checking many addresses
+
+    IrkContext() = default;
+    explicit IrkContext(const QByteArray &irk);
+
+    bool isValid() const { return m_aes.isValid(); }
+    quint64 id() const { return m_id; }
+
+    // Computes the 24-bit hash for the 24-bit random part, both little-endian
+    bool ah(const quint8 prand[3], quint8 hash[3]) const;
+
+    // Checks a resolvable private address against this IRK
+    bool verify(BluetoothAddress address) const;
+
+    // Checks several addresses, pipelining their AES blocks through as few EVP calls as possible
+    bool verifyBatch(const BluetoothAddress *addresses, int count, bool *results) const;
+
+private:
+    AesContext m_aes; // Bluetooth e() uses the byte-reversed key
+    quint64 m_id = 0;
+};
+
+/**
+ * @brief Encryption key for the Proximity Pairing payload, with a small memo of recent blocks.
+ *
+ * The encrypted battery payload repeats until the AirPods state changes, so the
+ * last few ciphertexts and their plaintexts are kept and reused.
+ */
+class EncKeyContext
+{
+public:
+    static constexpr int BLOCK_SIZE = 16;
+    static constexpr int CACHE_SIZE = 4;
+
+    struct Stats
+    {
+        quint64 hits = 0;
+        quint64 misses = 0;
+    };
+
+    EncKeyContext() = default;
+    explicit EncKeyContext(const QByteArray &key);
+
+    bool isValid() const { return m_aes.isValid(); }
+
+    bool decrypt(const quint8 ciphertext[BLOCK_SIZE], quint8 plaintext[BLOCK_SIZE]);
+    const Stats &stats() const { return m_stats; }
+
+private:
+    struct CacheEntry
+    {
+        bool used = false;
+        quint8 ciphertext[BLOCK_SIZE];
+        quint8 plaintext[BLOCK_SIZE];
+    };
+
+    AesContext m_aes;
+    CacheEntry m_cache[CACHE_SIZE];
+    int m_nextSlot = 0;
+    Stats m_stats;
+};
@@ -0,0 +1,199 @@
+#include "bleinfo.h"
+#include <array>
+#include <cstring>
+#include "continuity.hpp"
+#include "devicecatalog.h"
+
+namespace
+{
+// Decodes one message into the record, returns true if it describes an AirPods device
+using MessageDecoder = bool (*)(const Continuity::Message &message, BleInfo &out);
+
+bool decodeProximityPairing(const Continuity::Message &message, BleInfo &out)
+{
+    using ConnectionState = BleInfo::ConnectionState;
+    using LidState = BleInfo::LidState;
+
+    // Offsets below are into the value, after the type and length bytes
+    constexpr int VALUE_HEADER_SIZE = BleInfo::HEADER_SIZE - 2;
+    const quint8 *value = message.value;
+    const int length = message.length;
+
+    // Pairing mode (prefix 0x00) lays the fields out differently, only the model is at the same place
+    if (length >= 3 && value[0] == 0x00)
+    {
+        out.pairingMode = true;
+        out.modelId = static_cast<quint16>((value[1] << 8) | value[2]);
+        out.modelName = DeviceCatalog::fromModelId(out.modelId);
+        return true;
+    }
+    if (length < VALUE_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    // Raw fields are kept with their type and length bytes, the encrypted block separately
+    const quint8 *messageStart = value - 2;
+    int messageSize = length + 2;
+    if (length >= VALUE_HEADER_SIZE + BleInfo::ENCRYPTED_PAYLOAD_SIZE)
+    {
+        messageSize -= BleInfo::ENCRYPTED_PAYLOAD_SIZE;
+        std::memcpy(out.encryptedPayload, value + length - BleInfo::ENCRYPTED_PAYLOAD_SIZE, BleInfo::ENCRYPTED_PAYLOAD_SIZE);
+        out.hasEncryptedPayload = true;
+    }
+    out.rawSize = static_cast<quint8>(qMin(messageSize, BleInfo::MAX_RAW_SIZE));
+    std::memcpy(out.rawData, messageStart, out.rawSize);
+
+    // Parse device model (big-endian: high byte first)
+    out.modelId = static_cast<quint16>((value[1] << 8) | value[2]);
+    out.modelName = DeviceCatalog::fromModelId(out.modelId);
+
+    // Status byte for primary pod and other flags
+    quint8 status = value[3];
+    out.status = status;
+
+    // Pods battery byte (upper nibble: one pod, lower nibble: other pod)
+    quint8 podsBatteryByte = value[4];
+
+    // Flags and case battery byte (upper nibble: case battery, lower nibble: flags)
+    quint8 flagsAndCaseBattery = value[5];
+
+    // Lid open counter and device color
+    quint8 lidIndicator = value[6];
+    out.colorId = value[7];
+
+    out.connectionState = static_cast<ConnectionState>(value[8]);
+
+    // Determine primary pod (bit 5 of status) and value flipping
+    bool primaryLeft = (status & 0x20) != 0; // Bit 5: 1 = left primary, 0 = right primary
+    bool areValuesFlipped = !primaryLeft;    // Flipped when right pod is primary
+
+    out.primaryLeft = primaryLeft; // Store primary pod information
+
+    // Parse battery levels
+    int leftNibble = areValuesFlipped ? (podsBatteryByte >> 4) & 0x0F : podsBatteryByte & 0x0F;
+    int rightNibble = areValuesFlipped ? podsBatteryByte & 0x0F : (podsBatteryByte >> 4) & 0x0F;
+    out.leftPodBattery = (leftNibble == 15) ? -1 : leftNibble * 10;
+    out.rightPodBattery = (rightNibble == 15) ? -1 : rightNibble * 10;
+    int caseNibble = flagsAndCaseBattery & 0x0F; // Extracts lower nibble
+    out.caseBattery = (caseNibble == 15) ? -1 : caseNibble * 10;
+
+    // Parse charging statuses from flags (upper 4 bits of value[5])
+    quint8 flags = (flagsAndCaseBattery >> 4) & 0x0F;                               // Extracts lower nibble
+    out.rightCharging = areValuesFlipped ? (flags & 0x01) != 0 : (flags & 0x02) != 0; // Depending on primary, bit 0 or 1
+    out.leftCharging = areValuesFlipped ? (flags & 0x02) != 0 : (flags & 0x01) != 0;  // Depending on primary, bit 1 or 0
+    out.caseCharging = (flags & 0x04) != 0;                                           // bit 2
+
+    // Additional status flags from status byte (value[3])
+    out.isThisPodInTheCase = (status & 0x40) != 0; // Bit 6
+    out.isOnePodInCase = (status & 0x10) != 0;     // Bit 4
+    out.areBothPodsInCase = (status & 0x04) != 0;  // Bit 2
+
+    // In-ear detection with XOR logic
+    bool xorFactor = areValuesFlipped ^ out.isThisPodInTheCase;
+    out.isLeftPodInEar = xorFactor ? (status & 0x08) != 0 : (status & 0x02) != 0;  // Bit 3 or 1
+    out.isRightPodInEar = xorFactor ? (status & 0x02) != 0 : (status & 0x08) != 0; // Bit 1 or 3
+
+    // Determine primary and secondary in-ear status
+    out.isPrimaryInEar = primaryLeft ? out.isLeftPodInEar : out.isRightPodInEar;
+    out.isSecondaryInEar = primaryLeft ? out.isRightPodInEar : out.isLeftPodInEar;
+
+    // Microphone status
+    out.isLeftPodMicrophone = primaryLeft ^ out.isThisPodInTheCase;
+    out.isRightPodMicrophone = !primaryLeft ^ out.isThisPodInTheCase;
+
+    out.lidOpenCounter = lidIndicator & 0x07;                           // Extract bits 0-2 (count)
+    quint8 lidState = static_cast<quint8>((lidIndicator >> 3) & 0x01); // Extract bit 3 (lid state)
+    if (out.isThisPodInTheCase)
+    {
+        out.lidState = static_cast<LidState>(lidState);
+    }
+
+    return true;
+}
+
+bool decodeNearbyInfo(const Continuity::Message &message, BleInfo &out)
+{
+    // Status flags and activity level, data flags, then an authentication tag that is not needed here
+    if (message.length < 2)
+    {
+        return false;
+    }
+    out.hasNearbyInfo = true;
+    out.nearbyStatusFlags = message.value[0] >> 4;
+    out.activityLevel = static_cast<BleInfo::ActivityLevel>(message.value[0] & 0x0F);
+    out.nearbyDataFlags = message.value[1];
+
+    // Says what the sender is doing, not that it is AirPods
+    return false;
+}
+
+constexpr auto DECODERS = []
+{
+    std::array<MessageDecoder, 256> decoders{};
+    decoders[Continuity::ProximityPairing] = &decodeProximityPairing;
+    decoders[Continuity::NearbyInfo] = &decodeNearbyInfo;
+    return decoders;
+}();
+} // namespace
+
+bool BleInfo::decode(BluetoothAddress address, int rssi, const char *data, qsizetype size, qint64 seenMs, BleInfo &out)
+{
+    out = BleInfo();
+    out.address = address;
+    out.rssi = rssi;
+
+    // One pass over every message; types without a decoder are only recorded
+    bool decoded = false;
+    Continuity::forEachMessage(reinterpret_cast<const quint8 *>(data), size, [&out, &decoded](const Continuity::Message &message)
+    {
+        if (message.type < 32)
+        {
+            out.continuityTypes |= 1u << message.type;
+        }
+        if (MessageDecoder decoder = DECODERS[message.type])
+        {
+            decoded |= decoder(message, out);
+        }
+    });
+    if (!decoded)
+    {
+        return false;
+    }
+
+    // Update timestamp
+    out.lastSeen = seenMs;
+    return true;
+}
+
+QString BleInfo::addressString() const
+{
+    return address.toString();
+}
+
+QString BleInfo::colorName() const
+{
+    return DeviceCatalog::colorName(colorId);
+}
+
+QString BleInfo::connectionStateName() const
+{
+    switch (connectionState)
+    {
+    case ConnectionState::DISCONNECTED:
+        return QString("Disconnected");
+    case ConnectionState::IDLE:
+        return QString("Idle");
+    case ConnectionState::MUSIC:
+        return QString("Playing Music");
+    case ConnectionState::CALL:
+        return QString("On Call");
+    case ConnectionState::RINGING:
+        return QString("Ringing");
+    case ConnectionState::HANGING_UP:
+        return QString("Hanging Up");
+    case ConnectionState::UNKNOWN:
+    default:
+        return QString("Unknown");
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <type_traits>
+#include "bluetoothaddress.h"
+#include "enums.h"
+
+/**
+ * @brief Fixed-size record decoded from an Apple Proximity Pairing advertisement.
+ *
+ * The record is trivially copyable and holds no heap data: the address is kept
+ * as a BluetoothAddress value and the payload bytes in inline arrays. Strings
+ * are only built when a caller (or QML, through the gadget properties) asks.
+ */
+struct BleInfo
+{
+    Q_GADGET
+    Q_PROPERTY(QString address READ addressString)
+    Q_PROPERTY(QString color READ colorName)
+    Q_PROPERTY(int rssi MEMBER rssi)
+    Q_PROPERTY(int leftPodBattery MEMBER leftPodBattery)
+    Q_PROPERTY(int rightPodBattery MEMBER rightPodBattery)
+    Q_PROPERTY(int caseBattery MEMBER caseBattery)
+    Q_PROPERTY(AirpodsTrayApp::Enums::AirPodsModel model MEMBER modelName)
+    Q_PROPERTY(bool pairingMode MEMBER pairingMode)
+
+public:
+    static constexpr quint16 APPLE_MANUFACTURER_ID = 0x004C;
+    static constexpr quint8 PROXIMITY_PAIRING_TYPE = 0x07;
+    static constexpr int HEADER_SIZE = 11;            // Type and length up to and including the connection state
+    static constexpr int ENCRYPTED_PAYLOAD_SIZE = 16;
+    static constexpr int MAX_RAW_SIZE = 16;
+
+    // Lid state enumeration
+    enum class LidState : quint8
+    {
+        OPEN = 0x0,
+        CLOSED = 0x1,
+        UNKNOWN,
+    };
+
+    // Activity level in the low nibble of a Nearby Info message, as documented by public Continuity research
+    enum class ActivityLevel : quint8
+    {
+        UNKNOWN = 0x00,
+        REPORTING_DISABLED = 0x01,
+        IDLE = 0x03,
+        AUDIO_SCREEN_OFF = 0x05, // Audio playing while the screen is off
+        SCREEN_ON = 0x07,
+        VIDEO = 0x09,            // Screen on with video playing
+        WATCH_UNLOCKED = 0x0A,   // Watch on the wrist and unlocked
+        RECENT_INTERACTION = 0x0B,
+        DRIVING = 0x0D,
+        CALL = 0x0E,             // Phone call or FaceTime
+    };
+
+    // Connection state enumeration
+    enum class ConnectionState : quint8
+    {
+        DISCONNECTED = 0x00,
+        IDLE = 0x04,
+        MUSIC = 0x05,
+        CALL = 0x06,
+        RINGING = 0x07,
+        HANGING_UP = 0x09,
+        UNKNOWN = 0xFF // Using 0xFF for representing null in the original
+    };
+
+    BluetoothAddress address;
+    qint64 lastSeen = 0; // Milliseconds since epoch of last detection
+    int rssi = 0;
+    float rssiEwma = 0; // Smoothed over every advert of the address, suppressed ones included
+
+    int leftPodBattery = -1; // -1 indicates not available
+    int rightPodBattery = -1;
+    int caseBattery = -1;
+    AirpodsTrayApp::Enums::AirPodsModel modelName = AirpodsTrayApp::Enums::AirPodsModel::Unknown;
+    quint16 modelId = 0;
+    quint8 status = 0;
+    quint8 colorId = 0xFF;
+    quint8 lidOpenCounter = 0;
+    LidState lidState = LidState::UNKNOWN;
+    ConnectionState connectionState = ConnectionState::UNKNOWN;
+
+    bool leftCharging = false;
+    bool rightCharging = false;
+    bool caseCharging = false;
+
+    // Additional status flags from Kotlin version
+    bool isLeftPodInEar = false;
+    bool isRightPodInEar = false;
+    bool isPrimaryInEar = false;
+    bool isSecondaryInEar = false;
+    bool isLeftPodMicrophone = false;
+    bool isRightPodMicrophone = false;
+    bool isThisPodInTheCase = false;
+    bool isOnePodInCase = false;
+    bool areBothPodsInCase = false;
+    bool primaryLeft = true; // True if left pod is primary, false if right pod is primary
+
+    quint8 rawSize = 0;
+    quint8 rawData[MAX_RAW_SIZE] = {};
+    bool pairingMode = false;   // Only the model is known for devices waiting to be paired
+    quint32 continuityTypes = 0; // Bit n set when the advert carried a Continuity message of type n
+
+    // From a Nearby Info message, sent by the phone or Mac next to the AirPods rather than by the AirPods
+    bool hasNearbyInfo = false;
+    ActivityLevel activityLevel = ActivityLevel::UNKNOWN;
+    quint8 nearbyStatusFlags = 0; // High nibble of the first byte, kept as is
+    quint8 nearbyDataFlags = 0;
+
+    bool hasEncryptedPayload = false;
+    quint8 encryptedPayload[ENCRYPTED_PAYLOAD_SIZE] = {};
+
+    /**
+     * @brief Decodes Apple manufacturer data into a record without allocating
+     * @param address The advertiser address
+     * @param rssi Signal strength of the advertisement
+     * @param data Manufacturer specific data for company 0x004C, one or more Continuity messages
+     * @param size Size of data in bytes
+     * @param seenMs When the advert was seen, in milliseconds since epoch; the capture time on replay
+     * @param out Record to fill
+     * @return true if the data holds a Proximity Pairing message, paired or in pairing mode
+     */
+    static bool decode(BluetoothAddress address, int rssi, const char *data, qsizetype size, qint64 seenMs, BleInfo &out);
+
+    // Views over the inline payload; no copy is made
+    QByteArray rawDataBytes() const { return QByteArray::fromRawData(reinterpret_cast<const char *>(rawData), rawSize); }
+    QByteArray encryptedPayloadBytes() const
+    {
+        return hasEncryptedPayload ? QByteArray::fromRawData(reinterpret_cast<const char *>(encryptedPayload), ENCRYPTED_PAYLOAD_SIZE)
+                                   : QByteArray();
+    }
+
+    QString addressString() const;
+    QString colorName() const;
+    QString connectionStateName() const;
+};
+
+static_assert(std::is_trivially_copyable_v<BleInfo>, "BleInfo must stay a plain record");
@@ -1,230 +1,114 @@
 #include "blemanager.h"
-#include "enums.h"
-#include <QDebug>
-#include <QTimer>
 #include "logger.h"
-#include <QMap>
 
-AirpodsTrayApp::Enums::AirPodsModel getModelName(quint16 modelId)
+BleManager::BleManager(QObject *parent) : QObject(parent)
 {
-    using namespace AirpodsTrayApp::Enums;
-    static const QMap<quint16, AirPodsModel> modelMap = {
-        {0x0220, AirPodsModel::AirPods1},
-        {0x0F20, AirPodsModel::AirPods2},
-        {0x1320, AirPodsModel::AirPods3},
-        {0x1920, AirPodsModel::AirPods4},
-        {0x1B20, AirPodsModel::AirPods4ANC},
-        {0x0A20, AirPodsModel::AirPodsMaxLightning},
-        {0x1F20, AirPodsModel::AirPodsMaxUSBC},
-        {0x0E20, AirPodsModel::AirPodsPro},
-        {0x1420, AirPodsModel::AirPodsPro2Lightning},
-        {0x2420, AirPodsModel::AirPodsPro2USBC}
-    };
-
-    return modelMap.value(modelId, AirPodsModel::Unknown);
+    m_thread.setObjectName("BleScanner");
+    m_scanner = new BleScanner([this](const BleInfo &advert) { return enqueue(advert); });
+    m_scanner->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_scanner, &QObject::deleteLater);
+    connect(m_scanner, &BleScanner::scanStopped, this, &BleManager::onScanStopped);
+    m_thread.start();
+    QMetaObject::invokeMethod(m_scanner, &BleScanner::initialize, Qt::QueuedConnection);
+
+    m_drainTimer.setSingleShot(true);
+    m_drainTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_drainTimer, &QTimer::timeout, this, &BleManager::drain);
+    m_batch.reserve(QUEUE_CAPACITY);
+    m_batchIndex.reserve(QUEUE_CAPACITY);
 }
 
-QString getColorName(quint8 colorId)
+BleManager::~BleManager()
 {
-    switch (colorId)
-    {
-    case 0x00:
-        return "White";
-    case 0x01:
-        return "Black";
-    case 0x02:
-        return "Red";
-    case 0x03:
-        return "Blue";
-    case 0x04:
-        return "Pink";
-    case 0x05:
-        return "Gray";
-    case 0x06:
-        return "Silver";
-    case 0x07:
-        return "Gold";
-    case 0x08:
-        return "Rose Gold";
-    case 0x09:
-        return "Space Gray";
-    case 0x0A:
-        return "Dark Blue";
-    case 0x0B:
-        return "Light Blue";
-    case 0x0C:
-        return "Yellow";
-    default:
-        return "Unknown";
-    }
+    QMetaObject::invokeMethod(m_scanner, &BleScanner::stopScan, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
 }
 
-QString getConnectionStateName(BleInfo::ConnectionState state)
+void BleManager::startScan()
 {
-    using ConnectionState = BleInfo::ConnectionState;
-    switch (state)
-    {
-    case ConnectionState::DISCONNECTED:
-        return QString("Disconnected");
-    case ConnectionState::IDLE:
-        return QString("Idle");
-    case ConnectionState::MUSIC:
-        return QString("Playing Music");
-    case ConnectionState::CALL:
-        return QString("On Call");
-    case ConnectionState::RINGING:
-        return QString("Ringing");
-    case ConnectionState::HANGING_UP:
-        return QString("Hanging Up");
-    case ConnectionState::UNKNOWN:
-    default:
-        return QString("Unknown");
-    }
+    m_scanning = true;
+    QMetaObject::invokeMethod(m_scanner, &BleScanner::startScan, Qt::QueuedConnection);
 }
 
-BleManager::BleManager(QObject *parent) : QObject(parent)
+void BleManager::stopScan()
 {
-    discoveryAgent = new QBluetoothDeviceDiscoveryAgent(this);
-    discoveryAgent->setLowEnergyDiscoveryTimeout(0); // Continuous scanning
-
-    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered,
-            this, &BleManager::onDeviceDiscovered);
-    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::finished,
-            this, &BleManager::onScanFinished);
-    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::errorOccurred,
-            this, &BleManager::onErrorOccurred);
+    m_scanning = false;
+    QMetaObject::invokeMethod(m_scanner, &BleScanner::stopScan, Qt::QueuedConnection);
 }
 
-BleManager::~BleManager()
+void BleManager::onScanStopped()
 {
-    delete discoveryAgent;
+    if (!m_scanning)
+    {
+        return;
+    }
+    m_scanning = false;
+    emit scanStopped();
 }
 
-void BleManager::startScan()
+BleManager::Backend BleManager::backend() const
 {
-    LOG_DEBUG("Starting BLE scan...");
-    discoveryAgent->start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
+    return m_scanner->usesAdvertisementMonitor() ? Backend::AdvertisementMonitor : Backend::DiscoveryAgent;
 }
 
-void BleManager::stopScan()
+void BleManager::setHeartbeatInterval(int ms)
 {
-    LOG_DEBUG("Stopping BLE scan...");
-    discoveryAgent->stop();
+    QMetaObject::invokeMethod(m_scanner, [scanner = m_scanner, ms]() { scanner->setHeartbeatInterval(ms); }, Qt::QueuedConnection);
 }
 
-bool BleManager::isScanning() const
+bool BleManager::enqueue(const BleInfo &advert)
 {
-    return discoveryAgent->isActive();
+    if (!m_queue.push(advert))
+    {
+        return false;
+    }
+    // One wake-up per batch rather than a queued signal per advert
+    if (!m_drainPending.exchange(true, std::memory_order_acq_rel))
+    {
+        QMetaObject::invokeMethod(this, &BleManager::scheduleDrain, Qt::QueuedConnection);
+    }
+    return true;
 }
 
-void BleManager::onDeviceDiscovered(const QBluetoothDeviceInfo &info)
+void BleManager::scheduleDrain()
 {
-    // Check for Apple's manufacturer ID (0x004C)
-    if (info.manufacturerData().contains(0x004C))
+    if (m_drainTimer.isActive())
     {
-        QByteArray data = info.manufacturerData().value(0x004C);
-        // Ensure data is long enough and starts with prefix 0x07 (indicates Proximity Pairing Message)
-        if (data.size() >= 10 && data[0] == 0x07)
-        {
-            QString address = info.address().toString();
-            BleInfo deviceInfo;
-            deviceInfo.name = info.name().isEmpty() ? "AirPods" : info.name();
-            deviceInfo.address = address;
-            deviceInfo.rawData = data.left(data.size() - 16);
-            deviceInfo.encryptedPayload = data.mid(data.size() - 16);
-
-            // data[1] is the length of the data, so we can skip it
-
-            // Check if pairing mode is paired (0x01) or pairing (0x00)
-            if (data[2] == 0x00)
-            {
-                return; // Skip pairing mode devices (the values are differently structured)
-            }
-
-            
-            // Parse device model (big-endian: high byte at data[3], low byte at data[4])
-            deviceInfo.modelName = getModelName(static_cast<quint16>(data[4]) | (static_cast<quint8>(data[3]) << 8));
-
-            // Status byte for primary pod and other flags
-            quint8 status = static_cast<quint8>(data[5]);
-            deviceInfo.status = status;
-
-            // Pods battery byte (upper nibble: one pod, lower nibble: other pod)
-            quint8 podsBatteryByte = static_cast<quint8>(data[6]);
-
-            // Flags and case battery byte (upper nibble: case battery, lower nibble: flags)
-            quint8 flagsAndCaseBattery = static_cast<quint8>(data[7]);
-
-            // Lid open counter and device color
-            quint8 lidIndicator = static_cast<quint8>(data[8]);
-            deviceInfo.color = getColorName((quint8)(data[9]));
-
-            deviceInfo.connectionState = static_cast<BleInfo::ConnectionState>(data[10]);
-
-            // Next: Encrypted Payload: 16 bytes
-
-            // Determine primary pod (bit 5 of status) and value flipping
-            bool primaryLeft = (status & 0x20) != 0; // Bit 5: 1 = left primary, 0 = right primary
-            bool areValuesFlipped = !primaryLeft;    // Flipped when right pod is primary
-
-            deviceInfo.primaryLeft = primaryLeft; // Store primary pod information
-
-            // Parse battery levels
-            int leftNibble = areValuesFlipped ? (podsBatteryByte >> 4) & 0x0F : podsBatteryByte & 0x0F;
-            int rightNibble = areValuesFlipped ? podsBatteryByte & 0x0F : (podsBatteryByte >> 4) & 0x0F;
-            deviceInfo.leftPodBattery = (leftNibble == 15) ? -1 : leftNibble * 10;
-            deviceInfo.rightPodBattery = (rightNibble == 15) ? -1 : rightNibble * 10;
-            int caseNibble = flagsAndCaseBattery & 0x0F; // Extracts lower nibble
-            deviceInfo.caseBattery = (caseNibble == 15) ? -1 : caseNibble * 10;
-
-            // Parse charging statuses from flags (uper 4 bits of data[7])
-            quint8 flags = (flagsAndCaseBattery >> 4) & 0x0F;                                        // Extracts lower nibble
-            deviceInfo.rightCharging = areValuesFlipped ? (flags & 0x01) != 0 : (flags & 0x02) != 0; // Depending on primary, bit 0 or 1
-            deviceInfo.leftCharging = areValuesFlipped ? (flags & 0x02) != 0 : (flags & 0x01) != 0;  // Depending on primary, bit 1 or 0
-            deviceInfo.caseCharging = (flags & 0x04) != 0;                                           // bit 2
-
-            // Additional status flags from status byte (data[5])
-            deviceInfo.isThisPodInTheCase = (status & 0x40) != 0; // Bit 6
-            deviceInfo.isOnePodInCase = (status & 0x10) != 0;     // Bit 4
-            deviceInfo.areBothPodsInCase = (status & 0x04) != 0;  // Bit 2
-
-            // In-ear detection with XOR logic
-            bool xorFactor = areValuesFlipped ^ deviceInfo.isThisPodInTheCase;
-            deviceInfo.isLeftPodInEar = xorFactor ? (status & 0x08) != 0 : (status & 0x02) != 0;  // Bit 3 or 1
-            deviceInfo.isRightPodInEar = xorFactor ? (status & 0x02) != 0 : (status & 0x08) != 0; // Bit 1 or 3
-
-            // Determine primary and secondary in-ear status
-            deviceInfo.isPrimaryInEar = primaryLeft ? deviceInfo.isLeftPodInEar : deviceInfo.isRightPodInEar;
-            deviceInfo.isSecondaryInEar = primaryLeft ? deviceInfo.isRightPodInEar : deviceInfo.isLeftPodInEar;
-
-            // Microphone status
-            deviceInfo.isLeftPodMicrophone = primaryLeft ^ deviceInfo.isThisPodInTheCase;
-            deviceInfo.isRightPodMicrophone = !primaryLeft ^ deviceInfo.isThisPodInTheCase;
-
-            deviceInfo.lidOpenCounter = lidIndicator & 0x07; // Extract bits 0-2 (count)
-            quint8 lidState = static_cast<quint8>((lidIndicator >> 3) & 0x01); // Extract bit 3 (lid state)
-            if (deviceInfo.isThisPodInTheCase) {
-                deviceInfo.lidState = static_cast<BleInfo::LidState>(lidState);
-            }
-
-            // Update timestamp
-            deviceInfo.lastSeen = QDateTime::currentDateTime();
-
-            emit deviceFound(deviceInfo); // Emit signal for device found
-        }
+        return;
     }
+    // Deliver at most once per frame
+    qint64 elapsed = m_sinceDrain.isValid() ? m_sinceDrain.elapsed() : FRAME_INTERVAL_MS;
+    m_drainTimer.start(static_cast<int>(qMax<qint64>(0, FRAME_INTERVAL_MS - elapsed)));
 }
 
-void BleManager::onScanFinished()
+void BleManager::drain()
 {
-    if (discoveryAgent->isActive())
+    // Cleared before popping so records pushed from now on request a new drain
+    m_drainPending.exchange(false, std::memory_order_acq_rel);
+    m_sinceDrain.start();
+
+    m_batch.clear();
+    m_batchIndex.clear();
+    BleInfo advert;
+    while (m_queue.pop(advert))
     {
-        discoveryAgent->start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
+        // Only the latest record per device matters
+        auto it = m_batchIndex.constFind(advert.address);
+        if (it != m_batchIndex.constEnd())
+        {
+            m_batch[it.value()] = advert;
+        }
+        else
+        {
+            m_batchIndex.insert(advert.address, m_batch.size());
+            m_batch.append(advert);
+        }
     }
-}
 
-void BleManager::onErrorOccurred(QBluetoothDeviceDiscoveryAgent::Error error)
-{
-    LOG_ERROR("BLE scan error occurred:" << error);
-    stopScan();
+    if (!m_batch.isEmpty())
+    {
+        m_batches++;
+        emit advertsFound(m_batch);
+    }
 }
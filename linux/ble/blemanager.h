@@ -2,88 +2,77 @@
 #define BLEMANAGER_H
 
 #include <QObject>
-#include <QBluetoothDeviceDiscoveryAgent>
-#include <QMap>
-#include <QString>
-#include <QDateTime>
-#include "enums.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include "bleinfo.h"
+#include "blescanner.h"
+#include "spscqueue.hpp"
 
-class QTimer;
-
-class BleInfo
+/**
+ * @brief Runs BLE scanning and advert decoding on a worker thread.
+ *
+ * Decoded records cross to the GUI thread through a lock-free queue. The GUI
+ * side drains it at most once per frame and delivers one batch, with at most
+ * one record per device, through advertsFound().
+ */
+class BleManager : public QObject
 {
+    Q_OBJECT
 public:
-    QString name;
-    QString address;
-    int leftPodBattery = -1; // -1 indicates not available
-    int rightPodBattery = -1;
-    int caseBattery = -1;
-    bool leftCharging = false;
-    bool rightCharging = false;
-    bool caseCharging = false;
-    AirpodsTrayApp::Enums::AirPodsModel modelName = AirpodsTrayApp::Enums::AirPodsModel::Unknown;
-    quint8 lidOpenCounter = 0;
-    QString color = "Unknown"; // Default color
-    quint8 status = 0;
-    QByteArray rawData;
-    QByteArray encryptedPayload; // 16 bytes of encrypted payload
+    static constexpr int QUEUE_CAPACITY = 256;
+    static constexpr int FRAME_INTERVAL_MS = 16;
+    static constexpr int DEFAULT_HEARTBEAT_MS = BleScanner::DEFAULT_HEARTBEAT_MS;
 
-    // Additional status flags from Kotlin version
-    bool isLeftPodInEar = false;
-    bool isRightPodInEar = false;
-    bool isPrimaryInEar = false;
-    bool isSecondaryInEar = false;
-    bool isLeftPodMicrophone = false;
-    bool isRightPodMicrophone = false;
-    bool isThisPodInTheCase = false;
-    bool isOnePodInCase = false;
-    bool areBothPodsInCase = false;
-    bool primaryLeft = true; // True if left pod is primary, false if right pod is primary
+    using AdvertStats = BleScanner::Stats;
 
-    // Lid state enumeration
-    enum class LidState
+    enum class Backend
     {
-        OPEN = 0x0,
-        CLOSED = 0x1,
-        UNKNOWN,
-    } lidState = LidState::UNKNOWN;
-
-    // Connection state enumeration
-    enum class ConnectionState : uint8_t
-    {
-        DISCONNECTED = 0x00,
-        IDLE = 0x04,
-        MUSIC = 0x05,
-        CALL = 0x06,
-        RINGING = 0x07,
-        HANGING_UP = 0x09,
-        UNKNOWN = 0xFF // Using 0xFF for representing null in the original
-    } connectionState = ConnectionState::UNKNOWN;
-
-    QDateTime lastSeen; // Timestamp of last detection
-};
+        DiscoveryAgent,       // Every advert in range, filtered here
+        AdvertisementMonitor, // BlueZ AdvertisementMonitor1, filtered by BlueZ or the controller
+    };
 
-class BleManager : public QObject
-{
-    Q_OBJECT
-public:
     explicit BleManager(QObject *parent = nullptr);
     ~BleManager();
 
     void startScan();
     void stopScan();
-    bool isScanning() const;
+    bool isScanning() const { return m_scanning; }
+    Backend backend() const;
 
-private slots:
-    void onDeviceDiscovered(const QBluetoothDeviceInfo &info);
-    void onScanFinished();
-    void onErrorOccurred(QBluetoothDeviceDiscoveryAgent::Error error);
+    // Re-emit an unchanged advert at most this often, 0 never re-emits it
+    void setHeartbeatInterval(int ms);
+    AdvertStats advertStats() const { return m_scanner->stats(); }
+    quint64 batchesDelivered() const { return m_batches; }
 
 signals:
-    void deviceFound(const BleInfo &device);
+    void advertsFound(const QVector<BleInfo> &adverts);
+    // The scanner stopped without being asked to, startScan() starts it again
+    void scanStopped();
 
 private:
-    QBluetoothDeviceDiscoveryAgent *discoveryAgent;
+    // Worker thread
+    bool enqueue(const BleInfo &advert);
+
+    // GUI thread
+    void onScanStopped();
+    void scheduleDrain();
+    void drain();
+
+    QThread m_thread;
+    BleScanner *m_scanner;
+    SpscQueue<BleInfo, QUEUE_CAPACITY> m_queue;
+    std::atomic<bool> m_drainPending{false};
+    bool m_scanning = false;
+
+    QTimer m_drainTimer;
+    QElapsedTimer m_sinceDrain;
+    QVector<BleInfo> m_batch;
+    QHash<BluetoothAddress, int> m_batchIndex; // Address to position in m_batch
+    quint64 m_batches = 0;
 };
 
-#endif // BLEMANAGER_H
\ No newline at end of file
+#endif // BLEMANAGER_H
@@ -0,0 +1,185 @@
+#include "blescanner.h"
+#include "advertisementmonitor.h"
+#include "enums.h"
+#include <QDateTime>
+#include "logger.h"
+
+BleScanner::BleScanner(Sink sink) : m_sink(std::move(sink))
+{
+}
+
+BleScanner::~BleScanner() = default;
+
+void BleScanner::initialize()
+{
+    discoveryAgent = new QBluetoothDeviceDiscoveryAgent(this);
+    discoveryAgent->setLowEnergyDiscoveryTimeout(0); // Continuous scanning
+
+    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered,
+            this, &BleScanner::onDeviceDiscovered);
+    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::finished,
+            this, &BleScanner::onScanFinished);
+    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::errorOccurred,
+            this, &BleScanner::onErrorOccurred);
+
+    if (qEnvironmentVariable("LIBREPODS_BLE_BACKEND") == "monitor")
+    {
+        m_monitor = new AdvertisementMonitor(this);
+        m_usesMonitor = true;
+        connect(m_monitor, &AdvertisementMonitor::advertisement, this, &BleScanner::processManufacturerData);
+        connect(m_monitor, &AdvertisementMonitor::failed, this, &BleScanner::onMonitorFailed);
+    }
+
+    const QString capturePath = qEnvironmentVariable("LIBREPODS_BLE_CAPTURE");
+    if (!capturePath.isEmpty())
+    {
+        if (m_capture.open(capturePath))
+        {
+            LOG_INFO("Capturing BLE adverts to " << capturePath);
+        }
+        else
+        {
+            LOG_WARN("Cannot open BLE capture file " << capturePath);
+        }
+    }
+}
+
+BleScanner::Stats BleScanner::stats() const
+{
+    Stats stats;
+    stats.received = m_stats.received.load(std::memory_order_relaxed);
+    stats.emitted = m_stats.emitted.load(std::memory_order_relaxed);
+    stats.suppressed = m_stats.suppressed.load(std::memory_order_relaxed);
+    stats.heartbeats = m_stats.heartbeats.load(std::memory_order_relaxed);
+    stats.dropped = m_stats.dropped.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void BleScanner::startScan()
+{
+    LOG_DEBUG("Starting BLE scan...");
+    m_lastAdverts.clear(); // Process the first advert of every device again
+    m_scanRequested = true;
+    if (m_monitor && m_monitor->start())
+    {
+        return;
+    }
+    if (!discoveryAgent->isActive()) // A failing monitor may have started it already
+    {
+        discoveryAgent->start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
+    }
+}
+
+void BleScanner::stopScan()
+{
+    LOG_DEBUG("Stopping BLE scan...");
+    m_scanRequested = false;
+    if (m_monitor)
+    {
+        m_monitor->stop();
+    }
+    discoveryAgent->stop();
+}
+
+void BleScanner::onDeviceDiscovered(const QBluetoothDeviceInfo &info)
+{
+    // Only look up Apple's manufacturer ID (0x004C), the value is implicitly shared
+    const QByteArray data = info.manufacturerData(BleInfo::APPLE_MANUFACTURER_ID);
+    if (data.isEmpty())
+    {
+        return;
+    }
+
+    processManufacturerData(BluetoothAddress(info.address().toUInt64()), info.rssi(), data);
+}
+
+void BleScanner::processManufacturerData(BluetoothAddress address, int rssi, const QByteArray &data)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (m_capture.isOpen())
+    {
+        m_capture.write({now, address, static_cast<qint16>(rssi), data});
+    }
+    processAdvert(address, rssi, data, now);
+}
+
+void BleScanner::processAdvert(BluetoothAddress address, int rssi, const QByteArray &data, qint64 now)
+{
+    bump(m_stats.received);
+    const size_t payloadHash = qHashBits(data.constData(), data.size());
+
+    if (m_lastAdverts.size() >= MAX_TRACKED_ADVERTISERS && !m_lastAdverts.contains(address))
+    {
+        pruneAdvertisers(now);
+    }
+
+    // The raw fields and the encrypted block are both covered by the hash
+    AdvertRecord &record = m_lastAdverts[address];
+    // Every advert feeds the smoothed RSSI, so it stays current while an unchanged payload is suppressed
+    record.rssiEwma = record.lastSeenMs ? record.rssiEwma + RSSI_ALPHA * (rssi - record.rssiEwma) : rssi;
+    record.lastSeenMs = now;
+    if (record.lastProcessedMs && record.payloadHash == payloadHash)
+    {
+        if (m_heartbeatIntervalMs <= 0 || now - record.lastProcessedMs < m_heartbeatIntervalMs)
+        {
+            bump(m_stats.suppressed);
+            return;
+        }
+        bump(m_stats.heartbeats);
+    }
+    record.payloadHash = payloadHash;
+    record.lastProcessedMs = now;
+
+    BleInfo deviceInfo;
+    if (BleInfo::decode(address, rssi, data.constData(), data.size(), now, deviceInfo))
+    {
+        deviceInfo.rssiEwma = record.rssiEwma;
+        if (m_sink(deviceInfo))
+        {
+            bump(m_stats.emitted);
+        }
+        else
+        {
+            // The GUI thread is behind; the next change or heartbeat brings the device back
+            bump(m_stats.dropped);
+            m_lastAdverts.remove(address);
+        }
+    }
+}
+
+void BleScanner::pruneAdvertisers(qint64 nowMs)
+{
+    m_lastAdverts.removeIf([nowMs](QHash<BluetoothAddress, AdvertRecord>::iterator it) { return nowMs - it.value().lastSeenMs > STALE_ADVERTISER_MS; });
+    if (m_lastAdverts.size() >= MAX_TRACKED_ADVERTISERS)
+    {
+        // Every advertiser is recent (e.g. a crowded room), start over
+        m_lastAdverts.clear();
+    }
+}
+
+void BleScanner::onScanFinished()
+{
+    if (discoveryAgent->isActive())
+    {
+        discoveryAgent->start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
+    }
+}
+
+void BleScanner::onMonitorFailed(const QString &error)
+{
+    LOG_WARN("BLE advertisement monitor unavailable, falling back to the discovery agent: " << error);
+    m_monitor->deleteLater();
+    m_monitor = nullptr;
+    m_usesMonitor = false;
+    if (m_scanRequested && !discoveryAgent->isActive())
+    {
+        discoveryAgent->start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
+    }
+}
+
+void BleScanner::onErrorOccurred(QBluetoothDeviceDiscoveryAgent::Error error)
+{
+    LOG_ERROR("BLE scan error occurred:" << error);
+    stopScan();
+    emit scanStopped();
+}
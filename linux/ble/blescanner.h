@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QObject>
+#include <QBluetoothDeviceDiscoveryAgent>
+#include <QHash>
+#include <atomic>
+#include <functional>
+#include "advertcapture.h"
+#include "bleinfo.h"
+
+class AdvertisementMonitor;
+
+/**
+ * @brief Scans and decodes Apple adverts; lives on the BleManager worker thread.
+ *
+ * Unchanged payloads are dropped before decoding. Every decoded record is
+ * handed to the sink, which must be safe to call from the worker thread.
+ */
+class BleScanner : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int DEFAULT_HEARTBEAT_MS = 10000;
+    static constexpr int MAX_TRACKED_ADVERTISERS = 512;
+    static constexpr qint64 STALE_ADVERTISER_MS = 60000;
+    static constexpr float RSSI_ALPHA = 0.25f; // EWMA weight of the newest RSSI sample
+
+    struct Stats
+    {
+        quint64 received = 0;
+        quint64 emitted = 0;
+        quint64 suppressed = 0; // Unchanged payloads dropped before decoding
+        quint64 heartbeats = 0; // Unchanged payloads let through for liveness
+        quint64 dropped = 0;    // Decoded records the sink could not take
+    };
+
+    using Sink = std::function<bool(const BleInfo &)>;
+
+    explicit BleScanner(Sink sink);
+    ~BleScanner();
+
+    // Safe to call from any thread
+    Stats stats() const;
+    bool usesAdvertisementMonitor() const { return m_usesMonitor.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Filters, decodes and forwards one advert; the entry point of both backends and of capture replay
+     * @param address The advertiser address
+     * @param rssi Signal strength of the advert
+     * @param data Apple manufacturer specific data
+     * @param nowMs Time the advert was seen, in milliseconds since epoch
+     */
+    void processAdvert(BluetoothAddress address, int rssi, const QByteArray &data, qint64 nowMs);
+
+public slots:
+    // Creates the scanning backends, must run on the worker thread
+    void initialize();
+    void startScan();
+    void stopScan();
+    void setHeartbeatInterval(int ms) { m_heartbeatIntervalMs = ms; }
+
+signals:
+    // The scan stopped on its own, e.g. after an adapter error
+    void scanStopped();
+
+private slots:
+    void onDeviceDiscovered(const QBluetoothDeviceInfo &info);
+    void onScanFinished();
+    void onErrorOccurred(QBluetoothDeviceDiscoveryAgent::Error error);
+    void onMonitorFailed(const QString &error);
+    void processManufacturerData(BluetoothAddress address, int rssi, const QByteArray &data);
+
+private:
+    struct AdvertRecord
+    {
+        size_t payloadHash = 0;
+        qint64 lastProcessedMs = 0;
+        qint64 lastSeenMs = 0;
+        float rssiEwma = 0;
+    };
+
+    struct AtomicStats
+    {
+        std::atomic<quint64> received{0};
+        std::atomic<quint64> emitted{0};
+        std::atomic<quint64> suppressed{0};
+        std::atomic<quint64> heartbeats{0};
+        std::atomic<quint64> dropped{0};
+    };
+
+    static void bump(std::atomic<quint64> &counter) { counter.fetch_add(1, std::memory_order_relaxed); }
+    void pruneAdvertisers(qint64 nowMs);
+
+    Sink m_sink;
+    QBluetoothDeviceDiscoveryAgent *discoveryAgent = nullptr;
+    AdvertisementMonitor *m_monitor = nullptr; // Only when LIBREPODS_BLE_BACKEND=monitor
+    std::atomic<bool> m_usesMonitor{false};
+    bool m_scanRequested = false;
+    QHash<BluetoothAddress, AdvertRecord> m_lastAdverts; // Keyed by advertiser address
+    int m_heartbeatIntervalMs = DEFAULT_HEARTBEAT_MS;
+    AtomicStats m_stats;
+    AdvertCaptureWriter m_capture; // Only when LIBREPODS_BLE_CAPTURE is set
+};
@@ -2,6 +2,7 @@
 
 #include <QObject>
 #include <QByteArray>
+#include "bluetoothaddress.h"
 
 class BLEUtils : public QObject
 {
@@ -17,6 +18,14 @@ public:
      */
     static bool verifyRPA(const QString &address, const QByteArray &irk);
 
+    /**
+     * @brief Verifies an already parsed RPA
+     * @param address The Bluetooth address
+     * @param irk The Identity Resolving Key to use for verification
+     * @return true if the address is verified as an RPA matching the IRK
+     */
+    static bool verifyRPA(BluetoothAddress address, const QByteArray &irk);
+
     /**
      * @brief Checks if the given IRK and RPA are valid
      * @param irk The Identity Resolving Key
@@ -32,21 +41,4 @@ public:
      * @return The decrypted 16 bytes, or an empty QByteArray on failure
      */
     static QByteArray decryptLastBytes(const QByteArray &data, const QByteArray &key);
-
-private:
-    /**
-     * @brief Performs E function (AES-128) as specified in Bluetooth Core Specification
-     * @param key The key for encryption
-     * @param data The data to encrypt
-     * @return The encrypted data
-     */
-    static QByteArray e(const QByteArray &key, const QByteArray &data);
-
-    /**
-     * @brief Performs the ah function as specified in Bluetooth Core Specification
-     * @param k The IRK key
-     * @param r The random part of the address
-     * @return The hash part of the address
-     */
-    static QByteArray ah(const QByteArray &k, const QByteArray &r);
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QtGlobal>
+
+/**
+ * @brief Framing of Apple Continuity messages.
+ *
+ * Manufacturer data for company 0x004C is a sequence of messages, each a type
+ * byte, a length byte and that many value bytes. One advert can carry several
+ * of them. The walker hands out views into the caller's buffer; nothing is copied.
+ */
+namespace Continuity
+{
+// Message types with publicly documented layouts
+enum MessageType : quint8
+{
+    AirPrint = 0x03,
+    AirDrop = 0x05,
+    HomeKit = 0x06,
+    ProximityPairing = 0x07,
+    HeySiri = 0x08,
+    AirPlayTarget = 0x09,
+    AirPlaySource = 0x0A,
+    MagicSwitch = 0x0B,
+    Handoff = 0x0C,
+    TetheringTarget = 0x0D,
+    TetheringSource = 0x0E,
+    NearbyAction = 0x0F,
+    NearbyInfo = 0x10,
+    FindMy = 0x12,
+};
+
+struct Message
+{
+    quint8 type;
+    quint8 length;
+    const quint8 *value; // Points into the walked buffer
+};
+
+/**
+ * @brief Calls fn for every complete message in the data, in order
+ * @return false if the data ends inside a message; the messages before it were still visited
+ */
+template <typename Fn>
+bool forEachMessage(const quint8 *data, qsizetype size, Fn &&fn)
+{
+    qsizetype offset = 0;
+    while (offset + 2 <= size)
+    {
+        const Message message{data[offset], data[offset + 1], data + offset + 2};
+        if (offset + 2 + message.length > size)
+        {
+            return false;
+        }
+        fn(message);
+        offset += 2 + message.length;
+    }
+    return offset == size;
+}
+} // namespace Continuity
@@ -0,0 +1,81 @@
+#include "irkresolver.h"
+#include <algorithm>
+
+IrkResolver::IrkResolver(int cacheCapacity) : m_cache(cacheCapacity)
+{
+}
+
+quint64 IrkResolver::addKey(const QByteArray &irk)
+{
+    IrkContext context(irk);
+    if (!context.isValid())
+    {
+        return 0;
+    }
+
+    quint64 id = context.id();
+    auto it = std::find_if(m_keys.begin(), m_keys.end(), [id](const IrkContext &key) { return key.id() == id; });
+    if (it == m_keys.end())
+    {
+        m_keys.push_back(std::move(context));
+    }
+    return id;
+}
+
+void IrkResolver::removeKey(quint64 irkId)
+{
+    m_keys.erase(std::remove_if(m_keys.begin(), m_keys.end(), [irkId](const IrkContext &key) { return key.id() == irkId; }),
+                 m_keys.end());
+}
+
+void IrkResolver::resolveBatch(const BluetoothAddress *addresses, int count, quint64 *matchedIds, qint64 nowMs)
+{
+    m_pending.clear();
+    for (int i = 0; i < count; ++i)
+    {
+        matchedIds[i] = 0;
+        bool unknown = false;
+        for (const IrkContext &key : m_keys)
+        {
+            std::optional<bool> cached = m_cache.lookup(addresses[i], key.id(), nowMs);
+            if (cached.value_or(false))
+            {
+                matchedIds[i] = key.id();
+                break;
+            }
+            unknown |= !cached.has_value();
+        }
+        if (!matchedIds[i] && unknown)
+        {
+            m_pending.push_back(i);
+        }
+    }
+
+    BluetoothAddress batch[IrkContext::MAX_BATCH];
+    bool results[IrkContext::MAX_BATCH];
+    for (size_t start = 0; start < m_pending.size(); start += IrkContext::MAX_BATCH)
+    {
+        int blocks = static_cast<int>(std::min<size_t>(IrkContext::MAX_BATCH, m_pending.size() - start));
+        for (int j = 0; j < blocks; ++j)
+        {
+            batch[j] = addresses[m_pending[start + j]];
+        }
+
+        for (const IrkContext &key : m_keys)
+        {
+            if (!key.verifyBatch(batch, blocks, results))
+            {
+                continue;
+            }
+            for (int j = 0; j < blocks; ++j)
+            {
+                m_cache.insert(batch[j], key.id(), results[j], nowMs);
+                quint64 &matched = matchedIds[m_pending[start + j]];
+                if (results[j] && !matched)
+                {
+                    matched = key.id();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <vector>
+#include "blecrypto.h"
+#include "rpacache.h"
+
+/**
+ * @brief Resolves advertiser addresses against a set of Identity Resolving Keys.
+ *
+ * Verdicts are cached per (address, IRK). Addresses that still need work are
+ * collected and checked one key at a time, so every key costs one multi-block
+ * AES call per batch instead of one call per advert.
+ */
+class IrkResolver
+{
+public:
+    explicit IrkResolver(int cacheCapacity = RpaCache::DEFAULT_CAPACITY);
+
+    /**
+     * @brief Adds a key to the set
+     * @param irk The 16-byte Identity Resolving Key
+     * @return The key id reported by resolveBatch(), or 0 if the key is invalid
+     */
+    quint64 addKey(const QByteArray &irk);
+    void removeKey(quint64 irkId);
+    int keyCount() const { return static_cast<int>(m_keys.size()); }
+
+    /**
+     * @brief Resolves a batch of addresses
+     * @param addresses The advertiser addresses
+     * @param count Number of addresses
+     * @param matchedIds Receives, per address, the id of the matching key or 0
+     * @param nowMs Current time in milliseconds, used for cache expiry
+     */
+    void resolveBatch(const BluetoothAddress *addresses, int count, quint64 *matchedIds, qint64 nowMs);
+
+    const RpaCache::Stats &cacheStats() const { return m_cache.stats(); }
+
+private:
+    std::vector<IrkContext> m_keys;
+    RpaCache m_cache;
+    std::vector<int> m_pending; // Indices still unresolved after the cache pass
+};
@@ -0,0 +1,195 @@
+#include "knowndevices.h"
+#include "logger.h"
+#include "devicecatalog.h"
+#include <QSettings>
+
+KnownDevices::KnownDevices(DeviceInfo *current, QObject *parent)
+    : QObject(parent), m_current(current)
+{
+    connect(m_current, &DeviceInfo::deviceNameChanged, this, &KnownDevices::refreshCurrentIdentity);
+    connect(m_current, &DeviceInfo::modelChanged, this, &KnownDevices::refreshCurrentIdentity);
+    connect(m_current, &DeviceInfo::bluetoothAddressChanged, this, &KnownDevices::refreshCurrentIdentity);
+}
+
+void KnownDevices::load(QSettings &settings)
+{
+    int size = settings.beginReadArray("KnownDevices");
+    for (int i = 0; i < size; ++i)
+    {
+        settings.setArrayIndex(i);
+        QByteArray irk = settings.value("magicAccIRK").toByteArray();
+        quint64 id = m_resolver.addKey(irk);
+        if (!id || deviceFor(id))
+        {
+            continue;
+        }
+
+        auto *device = new DeviceInfo(this);
+        device->setDeviceName(settings.value("deviceName").toString());
+        device->setModel(static_cast<AirPodsModel>(settings.value("model", static_cast<int>(AirPodsModel::Unknown)).toInt()));
+        device->setBluetoothAddressString(settings.value("bluetoothAddress").toString());
+        device->setMagicAccIRK(irk);
+        device->setMagicAccEncKey(settings.value("magicAccEncKey").toByteArray());
+        m_entries.append(Entry{id, device});
+    }
+    settings.endArray();
+
+    // Settings from before multi-device support only hold the current device
+    rememberCurrentDevice();
+    LOG_INFO("Known AirPods: " << m_entries.size());
+}
+
+void KnownDevices::save(QSettings &settings) const
+{
+    settings.beginWriteArray("KnownDevices", m_entries.size());
+    for (int i = 0; i < m_entries.size(); ++i)
+    {
+        const DeviceInfo *device = m_entries[i].info;
+        settings.setArrayIndex(i);
+        settings.setValue("deviceName", device->deviceName());
+        settings.setValue("model", static_cast<int>(device->model()));
+        settings.setValue("bluetoothAddress", device->bluetoothAddressString());
+        settings.setValue("magicAccIRK", device->magicAccIRK());
+        settings.setValue("magicAccEncKey", device->magicAccEncKey());
+    }
+    settings.endArray();
+}
+
+void KnownDevices::rememberCurrentDevice()
+{
+    quint64 id = m_resolver.addKey(m_current->magicAccIRK());
+    if (!id)
+    {
+        return;
+    }
+
+    for (Entry &entry : m_entries)
+    {
+        if (entry.info == m_current && entry.irkId != id)
+        {
+            // Different AirPods took over the main DeviceInfo, keep the previous ones visible
+            entry.info = detachedCopy(m_currentIdentity);
+        }
+        else if (entry.irkId == id && entry.info != m_current)
+        {
+            entry.info->deleteLater();
+            entry.info = m_current;
+        }
+    }
+
+    if (!deviceFor(id))
+    {
+        m_entries.append(Entry{id, m_current});
+    }
+    m_currentIdentity = Identity{m_current->deviceName(), m_current->model(), m_current->bluetoothAddress(),
+                                 m_current->magicAccIRK(), m_current->magicAccEncKey()};
+    emit devicesChanged();
+}
+
+void KnownDevices::refreshCurrentIdentity()
+{
+    // Only while the remembered AirPods are connected: reset() clears the main DeviceInfo on
+    // disconnect, and other AirPods write their address and name before their keys arrive.
+    // A device remembered without an address gets one from rememberCurrentDevice() once its keys confirm it.
+    const BluetoothAddress address = m_current->bluetoothAddress();
+    if (m_currentIdentity.address.isNull() || address != m_currentIdentity.address
+        || m_current->magicAccIRK() != m_currentIdentity.irk)
+    {
+        return;
+    }
+    if (!m_current->deviceName().isEmpty())
+    {
+        m_currentIdentity.name = m_current->deviceName();
+    }
+    if (m_current->model() != AirPodsModel::Unknown)
+    {
+        m_currentIdentity.model = m_current->model();
+    }
+}
+
+QList<DeviceInfo *> KnownDevices::devices() const
+{
+    QList<DeviceInfo *> result;
+    result.reserve(m_entries.size());
+    for (const Entry &entry : m_entries)
+    {
+        result.append(entry.info);
+    }
+    return result;
+}
+
+void KnownDevices::handleAdverts(const QVector<BleInfo> &adverts)
+{
+    if (m_entries.isEmpty())
+    {
+        return;
+    }
+
+    // Adverts without the encrypted block cannot be resolved or applied
+    m_candidates.clear();
+    m_addresses.clear();
+    qint64 nowMs = 0;
+    for (int i = 0; i < adverts.size(); ++i)
+    {
+        if (adverts[i].hasEncryptedPayload)
+        {
+            m_candidates.append(i);
+            m_addresses.append(adverts[i].address);
+            nowMs = qMax(nowMs, adverts[i].lastSeen);
+        }
+    }
+    if (m_candidates.isEmpty())
+    {
+        return;
+    }
+
+    m_matches.resize(m_addresses.size());
+    // Cache expiry follows the time the adverts were seen, so a replayed capture ages the cache like it did live
+    m_resolver.resolveBatch(m_addresses.constData(), m_addresses.size(), m_matches.data(), nowMs);
+
+    for (int i = 0; i < m_candidates.size(); ++i)
+    {
+        if (DeviceInfo *device = m_matches[i] ? deviceFor(m_matches[i]) : nullptr)
+        {
+            apply(device, adverts[m_candidates[i]]);
+            emit deviceSeen(device);
+        }
+    }
+}
+
+DeviceInfo *KnownDevices::deviceFor(quint64 irkId) const
+{
+    for (const Entry &entry : m_entries)
+    {
+        if (entry.irkId == irkId)
+        {
+            return entry.info;
+        }
+    }
+    return nullptr;
+}
+
+DeviceInfo *KnownDevices::detachedCopy(const Identity &identity)
+{
+    auto *device = new DeviceInfo(this);
+    device->setDeviceName(identity.name);
+    device->setModel(identity.model);
+    device->setBluetoothAddress(identity.address);
+    device->setMagicAccIRK(identity.irk);
+    device->setMagicAccEncKey(identity.encKey);
+    return device;
+}
+
+void KnownDevices::apply(DeviceInfo *device, const BleInfo &advert)
+{
+    device->setModel(advert.modelName);
+
+    char decrypted[EncKeyContext::BLOCK_SIZE];
+    if (!device->encKeyContext().decrypt(advert.encryptedPayload, reinterpret_cast<quint8 *>(decrypted)))
+    {
+        return;
+    }
+    device->getBattery()->parseEncryptedPacket(QByteArray::fromRawData(decrypted, sizeof(decrypted)), advert.primaryLeft,
+                                               advert.isThisPodInTheCase, DeviceCatalog::entry(device->model()).headset);
+    device->getEarDetection()->overrideEarDetectionStatus(advert.isPrimaryInEar, advert.isSecondaryInEar);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QVector>
+#include "bleinfo.h"
+#include "deviceinfo.hpp"
+#include "irkresolver.h"
+
+class QSettings;
+
+/**
+ * @brief Remembers every AirPods the machine has been paired with and routes their adverts.
+ *
+ * Each known device has its own DeviceInfo. The one for the AirPods currently
+ * owned by the app is the app's main DeviceInfo, so the existing UI keeps
+ * showing it; the others are created here. Each batch of adverts from
+ * BleManager is resolved against all IRKs at once.
+ */
+class KnownDevices : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QList<DeviceInfo *> devices READ devices NOTIFY devicesChanged)
+
+public:
+    explicit KnownDevices(DeviceInfo *current, QObject *parent = nullptr);
+
+    void load(QSettings &settings);
+    void save(QSettings &settings) const;
+
+    // Registers the keys the current DeviceInfo holds, keeping previous AirPods as separate devices
+    void rememberCurrentDevice();
+
+    QList<DeviceInfo *> devices() const;
+    int count() const { return m_entries.size(); }
+    const RpaCache::Stats &resolverStats() const { return m_resolver.cacheStats(); }
+
+public slots:
+    void handleAdverts(const QVector<BleInfo> &adverts);
+
+signals:
+    void devicesChanged();
+    void deviceSeen(DeviceInfo *device);
+
+private:
+    struct Entry
+    {
+        quint64 irkId;
+        DeviceInfo *info;
+    };
+
+    // What identifies a device, copied out of the current DeviceInfo while it still holds it
+    struct Identity
+    {
+        QString name;
+        AirPodsModel model = AirPodsModel::Unknown;
+        BluetoothAddress address;
+        QByteArray irk;
+        QByteArray encKey;
+    };
+
+    DeviceInfo *deviceFor(quint64 irkId) const;
+    DeviceInfo *detachedCopy(const Identity &identity);
+    void refreshCurrentIdentity();
+    void apply(DeviceInfo *device, const BleInfo &advert);
+
+    DeviceInfo *m_current;
+    // The current device as last remembered, kept up to date while it stays connected. By the time
+    // other AirPods take over the main DeviceInfo their name, address and keys have been written to it.
+    Identity m_currentIdentity;
+    IrkResolver m_resolver;
+    QVector<Entry> m_entries;
+    QVector<int> m_candidates; // Positions in the batch with an encrypted payload
+    QVector<BluetoothAddress> m_addresses;
+    QVector<quint64> m_matches;
+};
@@ -0,0 +1,246 @@
+#include "nearbydevices.h"
+#include <QDateTime>
+#include <QMetaEnum>
+#include <cmath>
+#include "devicecatalog.h"
+
+int NearbyDeviceTable::homeSlot(BluetoothAddress address)
+{
+    // splitmix64 finalizer, addresses of one vendor share their upper bits
+    quint64 x = address.toUInt64();
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return static_cast<int>(x & (CAPACITY - 1));
+}
+
+int NearbyDeviceTable::findSlot(BluetoothAddress address) const
+{
+    for (int slot = homeSlot(address);; slot = (slot + 1) & (CAPACITY - 1))
+    {
+        const Entry &entry = m_slots[slot];
+        if (!entry.used)
+        {
+            return -1;
+        }
+        if (entry.last.address == address)
+        {
+            return slot;
+        }
+    }
+}
+
+NearbyDeviceTable::Entry *NearbyDeviceTable::find(BluetoothAddress address)
+{
+    int slot = findSlot(address);
+    return slot < 0 ? nullptr : &m_slots[slot];
+}
+
+NearbyDeviceTable::Entry *NearbyDeviceTable::update(const BleInfo &advert)
+{
+    if (Entry *entry = find(advert.address))
+    {
+        entry->last = advert;
+        return entry;
+    }
+
+    if (m_size >= MAX_DEVICES)
+    {
+        return nullptr;
+    }
+
+    int slot = homeSlot(advert.address);
+    while (m_slots[slot].used)
+    {
+        slot = (slot + 1) & (CAPACITY - 1);
+    }
+    Entry &entry = m_slots[slot];
+    entry.used = true;
+    entry.row = -1;
+    entry.firstSeenMs = advert.lastSeen;
+    entry.last = advert;
+    m_size++;
+    return &entry;
+}
+
+bool NearbyDeviceTable::remove(BluetoothAddress address)
+{
+    int hole = findSlot(address);
+    if (hole < 0)
+    {
+        return false;
+    }
+    m_slots[hole].used = false;
+    m_size--;
+
+    // Shift back entries whose probe chain passed through the hole
+    for (int slot = (hole + 1) & (CAPACITY - 1); m_slots[slot].used; slot = (slot + 1) & (CAPACITY - 1))
+    {
+        int home = homeSlot(m_slots[slot].last.address);
+        bool reachable = hole <= slot ? (home <= hole || home > slot) : (home <= hole && home > slot);
+        if (reachable)
+        {
+            m_slots[hole] = m_slots[slot];
+            m_slots[slot].used = false;
+            hole = slot;
+        }
+    }
+    return true;
+}
+
+BluetoothAddress NearbyDeviceTable::oldest() const
+{
+    const Entry *oldest = nullptr;
+    for (const Entry &entry : m_slots)
+    {
+        if (entry.used && (!oldest || entry.last.lastSeen < oldest->last.lastSeen))
+        {
+            oldest = &entry;
+        }
+    }
+    return oldest ? oldest->last.address : BluetoothAddress();
+}
+
+QVector<BluetoothAddress> NearbyDeviceTable::staleAddresses(qint64 cutoffMs) const
+{
+    QVector<BluetoothAddress> stale;
+    for (const Entry &entry : m_slots)
+    {
+        if (entry.used && entry.last.lastSeen < cutoffMs)
+        {
+            stale.append(entry.last.address);
+        }
+    }
+    return stale;
+}
+
+NearbyDevicesModel::NearbyDevicesModel(QObject *parent) : QAbstractListModel(parent)
+{
+    m_rows.reserve(NearbyDeviceTable::MAX_DEVICES);
+    m_expiryTimer.setInterval(EXPIRY_INTERVAL_MS);
+    connect(&m_expiryTimer, &QTimer::timeout, this, &NearbyDevicesModel::expire);
+    m_expiryTimer.start();
+}
+
+int NearbyDevicesModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant NearbyDevicesModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size())
+    {
+        return QVariant();
+    }
+
+    auto *entry = const_cast<NearbyDeviceTable &>(m_table).find(m_rows[index.row()]);
+    if (!entry)
+    {
+        return QVariant();
+    }
+
+    const BleInfo &info = entry->last;
+    switch (role)
+    {
+    case AddressRole:
+        return info.addressString();
+    case ModelRole:
+        return QString::fromLatin1(QMetaEnum::fromType<AirpodsTrayApp::Enums::AirPodsModel>().valueToKey(static_cast<int>(info.modelName)));
+    case IconRole:
+        return DeviceCatalog::entry(info.modelName).podIconName();
+    case RssiRole:
+        return static_cast<int>(std::lround(info.rssiEwma));
+    case LastSeenRole:
+        return info.lastSeen;
+    case FirstSeenRole:
+        return entry->firstSeenMs;
+    case LeftBatteryRole:
+        return info.leftPodBattery;
+    case RightBatteryRole:
+        return info.rightPodBattery;
+    case CaseBatteryRole:
+        return info.caseBattery;
+    case ColorRole:
+        return info.colorName();
+    case PairingModeRole:
+        return info.pairingMode;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> NearbyDevicesModel::roleNames() const
+{
+    return {
+        {AddressRole, "address"},
+        {ModelRole, "model"},
+        {IconRole, "icon"},
+        {RssiRole, "rssi"},
+        {LastSeenRole, "lastSeen"},
+        {FirstSeenRole, "firstSeen"},
+        {LeftBatteryRole, "leftBattery"},
+        {RightBatteryRole, "rightBattery"},
+        {CaseBatteryRole, "caseBattery"},
+        {ColorRole, "color"},
+        {PairingModeRole, "pairingMode"},
+    };
+}
+
+void NearbyDevicesModel::handleAdverts(const QVector<BleInfo> &adverts)
+{
+    for (const BleInfo &advert : adverts)
+    {
+        if (NearbyDeviceTable::Entry *entry = m_table.find(advert.address))
+        {
+            m_table.update(advert);
+            QModelIndex index = this->index(entry->row);
+            emit dataChanged(index, index);
+            continue;
+        }
+
+        if (m_table.size() >= NearbyDeviceTable::MAX_DEVICES)
+        {
+            // The device seen longest ago makes room, through the model so its row goes away first
+            removeDevice(m_table.oldest());
+        }
+
+        int row = m_rows.size();
+        beginInsertRows(QModelIndex(), row, row);
+        m_table.update(advert)->row = row;
+        m_rows.append(advert.address);
+        endInsertRows();
+        emit countChanged();
+    }
+}
+
+void NearbyDevicesModel::expire()
+{
+    const QVector<BluetoothAddress> stale = m_table.staleAddresses(QDateTime::currentMSecsSinceEpoch() - MAX_AGE_MS);
+    for (BluetoothAddress address : stale)
+    {
+        removeDevice(address);
+    }
+}
+
+void NearbyDevicesModel::removeDevice(BluetoothAddress address)
+{
+    NearbyDeviceTable::Entry *entry = m_table.find(address);
+    if (!entry)
+    {
+        return;
+    }
+
+    int row = entry->row;
+    beginRemoveRows(QModelIndex(), row, row);
+    m_table.remove(address);
+    m_rows.remove(row);
+    for (int i = row; i < m_rows.size(); ++i)
+    {
+        m_table.find(m_rows[i])->row = i;
+    }
+    endRemoveRows();
+    emit countChanged();
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QTimer>
+#include <QVector>
+#include <array>
+#include "bleinfo.h"
+
+/**
+ * @brief Fixed-capacity table of recently seen Proximity Pairing devices.
+ *
+ * Open addressing with linear probing on the 48-bit address, deletions shift
+ * the following cluster back so no tombstones build up. Memory never grows:
+ * callers make room with remove() once size() reaches MAX_DEVICES. Pointers
+ * returned by find()/update() are only valid until the next removal.
+ */
+class NearbyDeviceTable
+{
+public:
+    static constexpr int CAPACITY = 128;                 // Slots, a power of two
+    static constexpr int MAX_DEVICES = CAPACITY * 3 / 4; // Keeps probe chains short
+
+    struct Entry
+    {
+        bool used = false;
+        int row = -1; // Position in NearbyDevicesModel
+        qint64 firstSeenMs = 0;
+        BleInfo last; // Latest advert: address, model, payload, smoothed RSSI and lastSeen
+    };
+
+    Entry *find(BluetoothAddress address);
+
+    /**
+     * @brief Records an advert, inserting the device if needed
+     * @param advert The decoded advert
+     * @return The device's entry, or nullptr if the device is new and the table is full
+     */
+    Entry *update(const BleInfo &advert);
+    bool remove(BluetoothAddress address);
+
+    // The device seen longest ago, null if the table is empty
+    BluetoothAddress oldest() const;
+
+    // Collects the addresses of devices not seen since cutoffMs
+    QVector<BluetoothAddress> staleAddresses(qint64 cutoffMs) const;
+
+    int size() const { return m_size; }
+
+private:
+    static int homeSlot(BluetoothAddress address);
+    int findSlot(BluetoothAddress address) const;
+
+    std::array<Entry, CAPACITY> m_slots;
+    int m_size = 0;
+};
+
+/**
+ * @brief List model of nearby AirPods for pickers in QML.
+ */
+class NearbyDevicesModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    static constexpr qint64 MAX_AGE_MS = 60 * 1000; // Several heartbeats without an advert
+    static constexpr int EXPIRY_INTERVAL_MS = 10 * 1000;
+
+    enum Roles
+    {
+        AddressRole = Qt::UserRole + 1,
+        ModelRole,
+        IconRole,
+        RssiRole,
+        LastSeenRole,
+        FirstSeenRole,
+        LeftBatteryRole,
+        RightBatteryRole,
+        CaseBatteryRole,
+        ColorRole,
+        PairingModeRole,
+    };
+
+    explicit NearbyDevicesModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+public slots:
+    void handleAdverts(const QVector<BleInfo> &adverts);
+    void expire();
+
+signals:
+    void countChanged();
+
+private:
+    void removeDevice(BluetoothAddress address);
+
+    NearbyDeviceTable m_table;
+    QVector<BluetoothAddress> m_rows; // Addresses in display order
+    QTimer m_expiryTimer;
+};
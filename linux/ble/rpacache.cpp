@@ -0,0 +1,136 @@
+#include "rpacache.h"
+
+RpaCache::RpaCache(int capacity, qint64 ttlMs)
+    : m_capacity(qMax(1, capacity)), m_ttlMs(ttlMs)
+{
+    m_entries.reserve(m_capacity);
+    m_index.reserve(m_capacity);
+}
+
+std::optional<bool> RpaCache::lookup(BluetoothAddress address, quint64 irkId, qint64 nowMs)
+{
+    auto it = m_index.constFind(Key{address, irkId});
+    if (it == m_index.constEnd())
+    {
+        m_stats.misses++;
+        return std::nullopt;
+    }
+
+    int index = it.value();
+    Entry &entry = m_entries[index];
+    if (entry.expiresMs <= nowMs)
+    {
+        // The device has rotated past this address, resolve it again
+        m_stats.expired++;
+        m_stats.misses++;
+        return std::nullopt;
+    }
+
+    if (index != m_head)
+    {
+        unlink(index);
+        pushFront(index);
+    }
+    m_stats.hits++;
+    return entry.resolved;
+}
+
+void RpaCache::insert(BluetoothAddress address, quint64 irkId, bool resolved, qint64 nowMs)
+{
+    Key key{address, irkId};
+    int index;
+
+    auto it = m_index.constFind(key);
+    if (it != m_index.constEnd())
+    {
+        index = it.value();
+        unlink(index);
+    }
+    else if (static_cast<int>(m_entries.size()) < m_capacity)
+    {
+        index = static_cast<int>(m_entries.size());
+        m_entries.push_back(Entry{key, 0, false, -1, -1});
+        m_index.insert(key, index);
+    }
+    else
+    {
+        // Reuse the least recently used slot
+        index = m_tail;
+        unlink(index);
+        m_index.remove(m_entries[index].key);
+        m_entries[index].key = key;
+        m_index.insert(key, index);
+        m_stats.evictions++;
+    }
+
+    Entry &entry = m_entries[index];
+    entry.resolved = resolved;
+    entry.expiresMs = nowMs + m_ttlMs;
+    pushFront(index);
+}
+
+bool RpaCache::resolve(BluetoothAddress address, const IrkContext &irk, qint64 nowMs)
+{
+    if (!irk.isValid())
+    {
+        return false;
+    }
+
+    if (auto cached = lookup(address, irk.id(), nowMs))
+    {
+        return cached.value();
+    }
+
+    bool resolved = irk.verify(address);
+    insert(address, irk.id(), resolved, nowMs);
+    return resolved;
+}
+
+void RpaCache::clear()
+{
+    m_entries.clear();
+    m_index.clear();
+    m_head = -1;
+    m_tail = -1;
+}
+
+void RpaCache::unlink(int index)
+{
+    Entry &entry = m_entries[index];
+    if (entry.prev != -1)
+    {
+        m_entries[entry.prev].next = entry.next;
+    }
+    else if (m_head == index)
+    {
+        m_head = entry.next;
+    }
+
+    if (entry.next != -1)
+    {
+        m_entries[entry.next].prev = entry.prev;
+    }
+    else if (m_tail == index)
+    {
+        m_tail = entry.prev;
+    }
+
+    entry.prev = -1;
+    entry.next = -1;
+}
+
+void RpaCache::pushFront(int index)
+{
+    Entry &entry = m_entries[index];
+    entry.prev = -1;
+    entry.next = m_head;
+    if (m_head != -1)
+    {
+        m_entries[m_head].prev = index;
+    }
+    m_head = index;
+    if (m_tail == -1)
+    {
+        m_tail = index;
+    }
+}
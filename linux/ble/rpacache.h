@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QHash>
+#include <QtGlobal>
+#include <optional>
+#include <vector>
+#include "blecrypto.h"
+
+/**
+ * @brief Bounded LRU cache of RPA resolution verdicts.
+ *
+ * Resolvable private addresses repeat in every advert until the device rotates
+ * them (about every 15 minutes), so the verdict for an (address, IRK) pair is
+ * remembered for that long. A repeated advert costs one hash lookup instead of
+ * an AES operation.
+ */
+class RpaCache
+{
+public:
+    static constexpr int DEFAULT_CAPACITY = 256;
+    static constexpr qint64 DEFAULT_TTL_MS = 15 * 60 * 1000; // RPA rotation interval
+
+    struct Stats
+    {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 expired = 0;
+        quint64 evictions = 0;
+
+        double hitRate() const
+        {
+            quint64 total = hits + misses;
+            return total ? static_cast<double>(hits) / total : 0.0;
+        }
+    };
+
+    explicit RpaCache(int capacity = DEFAULT_CAPACITY, qint64 ttlMs = DEFAULT_TTL_MS);
+
+    std::optional<bool> lookup(BluetoothAddress address, quint64 irkId, qint64 nowMs);
+    void insert(BluetoothAddress address, quint64 irkId, bool resolved, qint64 nowMs);
+
+    /**
+     * @brief Resolves the address against the IRK, consulting the cache first
+     * @param address The advertiser address
+     * @param irk The prepared Identity Resolving Key
+     * @param nowMs Current time in milliseconds, used for expiry
+     * @return true if the address resolves with the IRK
+     */
+    bool resolve(BluetoothAddress address, const IrkContext &irk, qint64 nowMs);
+
+    void clear();
+    int size() const { return m_index.size(); }
+    const Stats &stats() const { return m_stats; }
+
+private:
+    struct Key
+    {
+        BluetoothAddress address;
+        quint64 irkId;
+        bool operator==(const Key &other) const { return address == other.address && irkId == other.irkId; }
+        friend size_t qHash(const Key &key, size_t seed) { return qHashMulti(seed, key.address, key.irkId); }
+    };
+
+    struct Entry
+    {
+        Key key;
+        qint64 expiresMs;
+        bool resolved;
+        int prev;
+        int next;
+    };
+
+    void unlink(int index);
+    void pushFront(int index);
+
+    int m_capacity;
+    qint64 m_ttlMs;
+    std::vector<Entry> m_entries; // Fixed slots, linked most recent first
+    QHash<Key, int> m_index;
+    int m_head = -1;
+    int m_tail = -1;
+    Stats m_stats;
+};
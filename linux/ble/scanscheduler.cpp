@@ -0,0 +1,199 @@
+#include "scanscheduler.h"
+#include "blemanager.h"
+#include "logger.h"
+
+ScanScheduler::ScanScheduler(BleManager *bleManager, QObject *parent)
+    : QObject(parent), m_bleManager(bleManager)
+{
+    m_aggressiveTimer.setSingleShot(true);
+    m_aggressiveTimer.setInterval(AGGRESSIVE_IDLE_MS);
+    connect(&m_aggressiveTimer, &QTimer::timeout, this, &ScanScheduler::onAggressiveIdle);
+
+    m_dutyTimer.setSingleShot(true);
+    connect(&m_dutyTimer, &QTimer::timeout, this, &ScanScheduler::onDutyTick);
+
+    m_telemetryTimer.setInterval(TELEMETRY_PERIOD_MS);
+    connect(&m_telemetryTimer, &QTimer::timeout, this, &ScanScheduler::reportTelemetry);
+    connect(m_bleManager, &BleManager::scanStopped, this, &ScanScheduler::onScanStopped);
+}
+
+qint64 ScanScheduler::scanOnMsThisHour() const
+{
+    return m_scanOnMsThisHour + (m_scanning ? m_scanOnTimer.elapsed() : 0);
+}
+
+void ScanScheduler::start()
+{
+    if (m_started)
+    {
+        return;
+    }
+    m_started = true;
+    m_hourTimer.start();
+    m_telemetryTimer.start();
+    enterState(!m_systemAwake ? State::Off : m_linkActive ? State::Paused : State::Aggressive);
+}
+
+void ScanScheduler::setSystemAwake(bool awake)
+{
+    m_systemAwake = awake;
+    if (!m_started)
+    {
+        return;
+    }
+    if (!awake)
+    {
+        enterState(State::Off);
+    }
+    else
+    {
+        // Whatever was nearby before sleeping may have changed
+        enterState(m_linkActive ? State::Paused : State::Aggressive);
+    }
+}
+
+void ScanScheduler::setLinkActive(bool active)
+{
+    if (m_linkActive == active)
+    {
+        return;
+    }
+    m_linkActive = active;
+    if (m_started && m_systemAwake)
+    {
+        enterState(active ? State::Paused : State::Aggressive);
+    }
+}
+
+void ScanScheduler::noteMatchingAdvert()
+{
+    if (m_state == State::Aggressive)
+    {
+        m_aggressiveTimer.start(); // Still seeing our AirPods, keep the scan going
+    }
+    else if (m_state == State::DutyCycled)
+    {
+        enterState(State::Aggressive);
+    }
+}
+
+void ScanScheduler::kick()
+{
+    if (m_state == State::DutyCycled)
+    {
+        enterState(State::Aggressive);
+    }
+    else if (m_state == State::Aggressive)
+    {
+        m_aggressiveTimer.start();
+    }
+}
+
+void ScanScheduler::enterState(State state)
+{
+    if (state != m_state)
+    {
+        LOG_DEBUG("BLE scan policy:" << m_state << "->" << state);
+    }
+    m_state = state;
+    m_aggressiveTimer.stop();
+    m_dutyTimer.stop();
+    m_dutyWindowOpen = false;
+
+    switch (state)
+    {
+    case State::Aggressive:
+        setScanning(true);
+        m_aggressiveTimer.start();
+        break;
+    case State::DutyCycled:
+        m_dutyPeriodMs = DUTY_MIN_PERIOD_MS;
+        setScanning(false);
+        m_dutyTimer.start(m_dutyPeriodMs - DUTY_WINDOW_MS);
+        break;
+    case State::Paused:
+    case State::Off:
+        setScanning(false);
+        break;
+    }
+    emit stateChanged(state);
+}
+
+void ScanScheduler::onAggressiveIdle()
+{
+    LOG_INFO("No known AirPods seen for " << AGGRESSIVE_IDLE_MS / 1000 << "s, duty cycling the BLE scan");
+    enterState(State::DutyCycled);
+}
+
+void ScanScheduler::onDutyTick()
+{
+    if (m_state != State::DutyCycled)
+    {
+        return;
+    }
+
+    if (!m_dutyWindowOpen)
+    {
+        m_dutyWindowOpen = true;
+        setScanning(true);
+        m_dutyTimer.start(DUTY_WINDOW_MS);
+    }
+    else
+    {
+        // Window closed without a match, wait longer before the next one
+        m_dutyWindowOpen = false;
+        setScanning(false);
+        m_dutyPeriodMs = qMin(m_dutyPeriodMs * 2, DUTY_MAX_PERIOD_MS);
+        m_dutyTimer.start(m_dutyPeriodMs - DUTY_WINDOW_MS);
+    }
+}
+
+void ScanScheduler::setScanning(bool scanning)
+{
+    if (scanning == m_scanning)
+    {
+        return;
+    }
+    m_scanning = scanning;
+    if (scanning)
+    {
+        m_bleManager->startScan();
+        m_scanOnTimer.start();
+    }
+    else
+    {
+        m_bleManager->stopScan();
+        m_scanOnMsThisHour += m_scanOnTimer.elapsed();
+    }
+}
+
+void ScanScheduler::onScanStopped()
+{
+    if (!m_scanning)
+    {
+        return;
+    }
+    // The next scan window or kick starts it again
+    LOG_WARN("BLE scan stopped unexpectedly in state " << m_state);
+    m_scanning = false;
+    m_scanOnMsThisHour += m_scanOnTimer.elapsed();
+    if (m_state == State::Aggressive)
+    {
+        enterState(State::DutyCycled);
+    }
+}
+
+void ScanScheduler::reportTelemetry()
+{
+    qint64 scanOnMs = scanOnMsThisHour();
+    qint64 periodMs = qMax<qint64>(1, m_hourTimer.restart());
+    LOG_INFO("BLE scan was on for " << scanOnMs / 1000 << "s in the last hour ("
+             << qRound(100.0 * scanOnMs / periodMs) << "%)");
+
+    m_scanOnMsLastHour = scanOnMs;
+    m_scanOnMsThisHour = 0;
+    if (m_scanning)
+    {
+        m_scanOnTimer.restart();
+    }
+}
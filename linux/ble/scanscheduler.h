@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+
+class BleManager;
+
+/**
+ * @brief Decides when the BLE scanner runs.
+ *
+ * - Aggressive: continuous scanning, after wake-up or when the AirPods link drops
+ * - DutyCycled: short scan windows with a growing gap, once nothing matching has been seen for a while
+ * - Paused: the AAP link delivers battery updates, adverts add nothing
+ * - Off: the system is going to sleep
+ */
+class ScanScheduler : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(State state READ state NOTIFY stateChanged)
+
+public:
+    enum class State
+    {
+        Off,
+        Aggressive,
+        DutyCycled,
+        Paused,
+    };
+    Q_ENUM(State)
+
+    static constexpr int AGGRESSIVE_IDLE_MS = 60 * 1000;    // Without a match, back off after this long
+    static constexpr int DUTY_WINDOW_MS = 5 * 1000;         // Scan-on time per duty cycle
+    static constexpr int DUTY_MIN_PERIOD_MS = 30 * 1000;
+    static constexpr int DUTY_MAX_PERIOD_MS = 5 * 60 * 1000;
+    static constexpr int TELEMETRY_PERIOD_MS = 60 * 60 * 1000;
+
+    explicit ScanScheduler(BleManager *bleManager, QObject *parent = nullptr);
+
+    State state() const { return m_state; }
+
+    // Scan-on time since the last hourly report, and the total of the last full hour
+    qint64 scanOnMsThisHour() const;
+    qint64 scanOnMsLastHour() const { return m_scanOnMsLastHour; }
+
+public slots:
+    void start();
+    void setSystemAwake(bool awake);
+    void setLinkActive(bool active);
+    void noteMatchingAdvert();
+    void kick(); // Something changed nearby, scan aggressively unless paused
+
+signals:
+    void stateChanged(State state);
+
+private:
+    void enterState(State state);
+    void setScanning(bool scanning);
+    void onScanStopped();
+    void onAggressiveIdle();
+    void onDutyTick();
+    void reportTelemetry();
+
+    BleManager *m_bleManager;
+    State m_state = State::Off;
+    bool m_started = false;
+    bool m_systemAwake = true;
+    bool m_linkActive = false;
+
+    QTimer m_aggressiveTimer;
+    QTimer m_dutyTimer;
+    int m_dutyPeriodMs = DUTY_MIN_PERIOD_MS;
+    bool m_dutyWindowOpen = false;
+
+    bool m_scanning = false;
+    QElapsedTimer m_scanOnTimer;
+    qint64 m_scanOnMsThisHour = 0;
+    qint64 m_scanOnMsLastHour = 0;
+    QElapsedTimer m_hourTimer;
+    QTimer m_telemetryTimer;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <QDebug>
+#include <QHashFunctions>
+#include <QMetaType>
+#include <QString>
+#include <QStringView>
+#include <array>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief 48-bit Bluetooth device address stored as a plain integer.
+ *
+ * Byte 0 is the most significant one and is written first, matching
+ * QBluetoothAddress::toUInt64(). Parsing and formatting are constexpr and never
+ * allocate. Bytes can be separated by ':' (BlueZ properties, bluetoothctl), by '_'
+ * (BlueZ object paths, PulseAudio card and sink names) or by '-'.
+ */
+class BluetoothAddress
+{
+public:
+    static constexpr int STRING_LENGTH = 17; // "AA:BB:CC:DD:EE:FF"
+    static constexpr quint64 MASK = 0xFFFFFFFFFFFFULL;
+
+    constexpr BluetoothAddress() = default;
+    constexpr explicit BluetoothAddress(quint64 value) : m_value(value & MASK) {}
+
+    // Both return a null address if the text is not six separated hex pairs
+    static constexpr BluetoothAddress fromString(std::string_view text) { return parse(text.data(), text.size()); }
+    static constexpr BluetoothAddress fromString(QStringView text) { return parse(text.utf16(), text.size()); }
+
+    // Reads the address at the end of a BlueZ device object path, e.g. /org/bluez/hci0/dev_AA_BB_CC_DD_EE_FF
+    static constexpr BluetoothAddress fromDevicePath(QStringView path)
+    {
+        return path.size() < STRING_LENGTH ? BluetoothAddress() : fromString(path.right(STRING_LENGTH));
+    }
+
+    constexpr quint64 toUInt64() const { return m_value; }
+    constexpr bool isNull() const { return m_value == 0; }
+
+    // Byte 0 is the most significant
+    constexpr quint8 byte(int index) const { return static_cast<quint8>(m_value >> (8 * (5 - index))); }
+
+    // Sub types of random addresses, told apart by the two most significant bits.
+    // Only meaningful when the address is known to be a random one (all LE advertisers here).
+    constexpr bool isResolvablePrivate() const { return (m_value >> 46) == 0b01; }
+    constexpr bool isNonResolvablePrivate() const { return (m_value >> 46) == 0b00; }
+    constexpr bool isStaticRandom() const { return (m_value >> 46) == 0b11; }
+
+    // Halves of a resolvable private address: the upper 24 bits are prand, the lower 24 the hash
+    constexpr quint32 prand() const { return static_cast<quint32>(m_value >> 24); }
+    constexpr quint32 hash() const { return static_cast<quint32>(m_value & 0xFFFFFF); }
+
+    constexpr std::array<char, STRING_LENGTH> toChars(char separator = ':') const
+    {
+        constexpr char digits[] = "0123456789ABCDEF";
+        std::array<char, STRING_LENGTH> out{};
+        for (int i = 0; i < 6; ++i)
+        {
+            out[i * 3] = digits[byte(i) >> 4];
+            out[i * 3 + 1] = digits[byte(i) & 0xF];
+            if (i < 5)
+            {
+                out[i * 3 + 2] = separator;
+            }
+        }
+        return out;
+    }
+
+    QString toString(char separator = ':') const
+    {
+        const auto chars = toChars(separator);
+        return QString::fromLatin1(chars.data(), STRING_LENGTH);
+    }
+
+    friend constexpr bool operator==(BluetoothAddress a, BluetoothAddress b) { return a.m_value == b.m_value; }
+    friend constexpr bool operator!=(BluetoothAddress a, BluetoothAddress b) { return a.m_value != b.m_value; }
+    friend constexpr bool operator<(BluetoothAddress a, BluetoothAddress b) { return a.m_value < b.m_value; }
+
+private:
+    static constexpr int hexValue(char16_t c)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F')
+        {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    template <typename Char>
+    static constexpr BluetoothAddress parse(const Char *data, qsizetype size)
+    {
+        if (size != STRING_LENGTH)
+        {
+            return BluetoothAddress();
+        }
+
+        quint64 value = 0;
+        for (int i = 0; i < STRING_LENGTH; ++i)
+        {
+            const auto c = static_cast<char16_t>(static_cast<std::make_unsigned_t<Char>>(data[i]));
+            if (i % 3 == 2)
+            {
+                if (c != ':' && c != '_' && c != '-')
+                {
+                    return BluetoothAddress();
+                }
+                continue;
+            }
+            int digit = hexValue(c);
+            if (digit < 0)
+            {
+                return BluetoothAddress();
+            }
+            value = (value << 4) | static_cast<quint64>(digit);
+        }
+        return BluetoothAddress(value);
+    }
+
+    quint64 m_value = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<BluetoothAddress> && sizeof(BluetoothAddress) == 8,
+              "BluetoothAddress must stay a plain 64-bit value");
+static_assert(BluetoothAddress::fromString(std::string_view("4A:12:34:56:78:9a")).toUInt64() == 0x4A123456789AULL);
+static_assert(BluetoothAddress::fromString(std::string_view("4A_12_34_56_78_9A")).isResolvablePrivate());
+
+inline size_t qHash(BluetoothAddress address, size_t seed = 0) noexcept
+{
+    return qHash(address.toUInt64(), seed);
+}
+
+inline QDebug operator<<(QDebug debug, BluetoothAddress address)
+{
+    QDebugStateSaver saver(debug);
+    debug.noquote() << address.toString();
+    return debug;
+}
+
+Q_DECLARE_METATYPE(BluetoothAddress)
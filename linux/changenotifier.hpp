@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+/**
+ * @brief Folds property changes into one notification per event loop tick or frame.
+ *
+ * Owners mark properties dirty as they change and emit their NOTIFY signals
+ * from changed(), so a burst of packets or a reset costs one UI update instead
+ * of one per field.
+ */
+class ChangeNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    // One bit per property, defined by the owner
+    using Mask = quint32;
+
+    struct Stats
+    {
+        quint64 changes = 0; // markDirty() calls
+        quint64 flushes = 0; // changed() emissions
+    };
+
+    explicit ChangeNotifier(QObject *parent = nullptr) : QObject(parent)
+    {
+        m_timer.setSingleShot(true);
+        connect(&m_timer, &QTimer::timeout, this, &ChangeNotifier::flush);
+    }
+
+    // 0 flushes on the next event loop tick, 16 about once per frame
+    void setInterval(int ms) { m_timer.setInterval(ms); }
+
+    void markDirty(Mask properties)
+    {
+        m_dirty |= properties;
+        m_folded++;
+        m_stats.changes++;
+        if (!m_timer.isActive())
+        {
+            m_timer.start();
+        }
+    }
+
+    bool isDirty(Mask properties) const { return m_dirty & properties; }
+
+    // Emits the pending changes now instead of waiting for the timer
+    void flush()
+    {
+        m_timer.stop();
+        if (!m_dirty)
+        {
+            return;
+        }
+        // Cleared first, so changes made by receivers land in the next flush
+        const Mask dirty = m_dirty;
+        const int folded = m_folded;
+        m_dirty = 0;
+        m_folded = 0;
+        m_stats.flushes++;
+        emit changed(dirty, folded);
+    }
+
+    const Stats &stats() const { return m_stats; }
+
+signals:
+    // foldedChanges counts the markDirty() calls behind this notification
+    void changed(ChangeNotifier::Mask properties, int foldedChanges);
+
+private:
+    QTimer m_timer;
+    Mask m_dirty = 0;
+    int m_folded = 0;
+    Stats m_stats;
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <QLatin1String>
+#include <QString>
+#include <QStringView>
+#include <array>
+#include "enums.h"
+
+/**
+ * @brief Everything the app knows per AirPods model, as constant tables.
+ *
+ * Entries are indexed by AirPodsModel, model numbers and Proximity Pairing
+ * model ids are looked up by binary search in arrays sorted at compile time.
+ * Nothing is built at runtime.
+ */
+namespace DeviceCatalog
+{
+using AirpodsTrayApp::Enums::AirPodsModel;
+
+// What a model accepts over AAP; commands for anything else are not sent
+enum Feature : quint32
+{
+    NoiseCancellation = 1 << 0, // Noise cancellation and transparency modes
+    AdaptiveMode = 1 << 1,      // Adaptive mode and its noise level
+    ConversationalAwareness = 1 << 2,
+    OneBudANC = 1 << 3,
+    HearingAid = 1 << 4,
+    HeadTracking = 1 << 5,
+
+    AllFeatures = 0x3F,
+};
+
+struct Entry
+{
+    AirPodsModel model;
+    quint16 modelId;      // Proximity Pairing model id, 0 if none
+    const char *podIcon;  // File names under assets/
+    const char *caseIcon;
+    bool headset;         // One battery instead of two buds and a case
+    quint32 features;
+
+    constexpr bool supports(Feature feature) const { return (features & feature) == feature; }
+    QString podIconName() const { return QLatin1String(podIcon); }
+    QString caseIconName() const { return QLatin1String(caseIcon); }
+};
+
+// In AirPodsModel order
+inline constexpr std::array<Entry, 11> ENTRIES = {{
+    // Unknown models are not held back, the device rejects what it does not support
+    {AirPodsModel::Unknown, 0x0000, "pod.png", "pod_case.png", false, AllFeatures},
+    {AirPodsModel::AirPods1, 0x0220, "pod.png", "pod_case.png", false, 0},
+    {AirPodsModel::AirPods2, 0x0F20, "pod.png", "pod_case.png", false, 0},
+    {AirPodsModel::AirPods3, 0x1320, "pod3.png", "pod3_case.png", false, HeadTracking},
+    {AirPodsModel::AirPodsPro, 0x0E20, "podpro.png", "podpro_case.png", false,
+     NoiseCancellation | OneBudANC | HeadTracking},
+    {AirPodsModel::AirPodsPro2Lightning, 0x1420, "podpro.png", "podpro_case.png", false, AllFeatures},
+    {AirPodsModel::AirPodsPro2USBC, 0x2420, "podpro.png", "podpro_case.png", false, AllFeatures},
+    {AirPodsModel::AirPodsMaxLightning, 0x0A20, "podmax.png", "max_case.png", true, NoiseCancellation | HeadTracking},
+    {AirPodsModel::AirPodsMaxUSBC, 0x1F20, "podmax.png", "max_case.png", true, NoiseCancellation | HeadTracking},
+    {AirPodsModel::AirPods4, 0x1920, "pod3.png", "pod4_case.png", false, HeadTracking},
+    {AirPodsModel::AirPods4ANC, 0x1B20, "pod3.png", "pod4_case.png", false,
+     NoiseCancellation | AdaptiveMode | ConversationalAwareness | OneBudANC | HeadTracking},
+}};
+
+struct ModelNumber
+{
+    quint16 number; // Digits after the 'A', e.g. 2084 for A2084
+    AirPodsModel model;
+};
+
+// Model numbers taken from https://support.apple.com/en-us/109525, sorted by number
+inline constexpr std::array<ModelNumber, 22> MODEL_NUMBERS = {{
+    {1523, AirPodsModel::AirPods1},
+    {1722, AirPodsModel::AirPods1},
+    {2031, AirPodsModel::AirPods2},
+    {2032, AirPodsModel::AirPods2},
+    {2083, AirPodsModel::AirPodsPro},
+    {2084, AirPodsModel::AirPodsPro},
+    {2096, AirPodsModel::AirPodsMaxLightning},
+    {2564, AirPodsModel::AirPods3},
+    {2565, AirPodsModel::AirPods3},
+    {2698, AirPodsModel::AirPodsPro2Lightning},
+    {2699, AirPodsModel::AirPodsPro2Lightning},
+    {2931, AirPodsModel::AirPodsPro2Lightning},
+    {3047, AirPodsModel::AirPodsPro2USBC},
+    {3048, AirPodsModel::AirPodsPro2USBC},
+    {3049, AirPodsModel::AirPodsPro2USBC},
+    {3050, AirPodsModel::AirPods4},
+    {3053, AirPodsModel::AirPods4},
+    {3054, AirPodsModel::AirPods4},
+    {3055, AirPodsModel::AirPods4ANC},
+    {3056, AirPodsModel::AirPods4ANC},
+    {3057, AirPodsModel::AirPods4ANC},
+    {3184, AirPodsModel::AirPodsMaxUSBC},
+}};
+
+struct ModelId
+{
+    quint16 id;
+    AirPodsModel model;
+};
+
+// Proximity Pairing model ids from ENTRIES, sorted by id
+inline constexpr auto MODEL_IDS = []()
+{
+    std::array<ModelId, ENTRIES.size() - 1> ids{};
+    for (std::size_t i = 1; i < ENTRIES.size(); ++i)
+    {
+        // Insertion sort, the table is tiny
+        std::size_t j = i - 1;
+        for (; j > 0 && ids[j - 1].id > ENTRIES[i].modelId; --j)
+        {
+            ids[j] = ids[j - 1];
+        }
+        ids[j] = {ENTRIES[i].modelId, ENTRIES[i].model};
+    }
+    return ids;
+}();
+
+inline constexpr std::array<const char *, 13> COLOR_NAMES = {
+    "White", "Black", "Red", "Blue", "Pink", "Gray", "Silver", "Gold", "Rose Gold", "Space Gray", "Dark Blue",
+    "Light Blue", "Yellow"};
+
+constexpr bool isConsistent()
+{
+    for (std::size_t i = 0; i < ENTRIES.size(); ++i)
+    {
+        if (static_cast<std::size_t>(ENTRIES[i].model) != i)
+        {
+            return false;
+        }
+    }
+    for (std::size_t i = 1; i < MODEL_NUMBERS.size(); ++i)
+    {
+        if (MODEL_NUMBERS[i - 1].number >= MODEL_NUMBERS[i].number)
+        {
+            return false;
+        }
+    }
+    for (std::size_t i = 1; i < MODEL_IDS.size(); ++i)
+    {
+        if (MODEL_IDS[i - 1].id >= MODEL_IDS[i].id)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(isConsistent(), "ENTRIES must follow AirPodsModel, lookup tables must be sorted without duplicates");
+
+constexpr const Entry &entry(AirPodsModel model)
+{
+    const auto index = static_cast<std::size_t>(model);
+    return index < ENTRIES.size() ? ENTRIES[index] : ENTRIES[0];
+}
+
+template <typename Table, typename Key, typename KeyOf>
+constexpr AirPodsModel lowerBoundLookup(const Table &table, Key key, KeyOf keyOf)
+{
+    std::size_t first = 0;
+    std::size_t last = table.size();
+    while (first < last)
+    {
+        const std::size_t middle = first + (last - first) / 2;
+        if (keyOf(table[middle]) < key)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+    return first < table.size() && keyOf(table[first]) == key ? table[first].model : AirPodsModel::Unknown;
+}
+
+// Model from a model number such as "A2084"
+constexpr AirPodsModel fromModelNumber(QStringView modelNumber)
+{
+    if (modelNumber.size() != 5 || modelNumber[0] != u'A')
+    {
+        return AirPodsModel::Unknown;
+    }
+    quint16 number = 0;
+    for (qsizetype i = 1; i < modelNumber.size(); ++i)
+    {
+        const char16_t c = modelNumber[i].unicode();
+        if (c < u'0' || c > u'9')
+        {
+            return AirPodsModel::Unknown;
+        }
+        number = static_cast<quint16>(number * 10 + (c - u'0'));
+    }
+    return lowerBoundLookup(MODEL_NUMBERS, number, [](const ModelNumber &entry) { return entry.number; });
+}
+
+// Model from the id in a Proximity Pairing advert
+constexpr AirPodsModel fromModelId(quint16 modelId)
+{
+    return lowerBoundLookup(MODEL_IDS, modelId, [](const ModelId &entry) { return entry.id; });
+}
+
+inline QString colorName(quint8 colorId)
+{
+    return colorId < COLOR_NAMES.size() ? QLatin1String(COLOR_NAMES[colorId]) : QLatin1String("Unknown");
+}
+
+static_assert(fromModelId(0x2420) == AirPodsModel::AirPodsPro2USBC && fromModelId(0x1234) == AirPodsModel::Unknown);
+static_assert(entry(AirPodsModel::AirPodsMaxUSBC).headset && !entry(AirPodsModel::AirPods4).supports(NoiseCancellation));
+static_assert(!entry(AirPodsModel::AirPods2).supports(HeadTracking) && entry(AirPodsModel::AirPods3).supports(HeadTracking));
+} // namespace DeviceCatalog
@@ -2,13 +2,33 @@
 
 #include <QObject>
 #include <QByteArray>
+#include <QDateTime>
 #include <QSettings>
+#include <atomic>
 #include "battery.hpp"
+#include "batterypredictor.hpp"
+#include "bluetoothaddress.h"
+#include "changenotifier.hpp"
+#include "devicecatalog.h"
+#include "devicestate.h"
 #include "enums.h"
 #include "eardetection.hpp"
+#include "seqlock.hpp"
+#include "ble/blecrypto.h"
 
 using namespace AirpodsTrayApp::Enums;
 
+/**
+ * @brief QML-facing view of the connected device.
+ *
+ * The device state itself lives in a SeqLock-published DeviceState: any thread
+ * can read it with snapshot() or change it with updateState(). The properties
+ * here follow it on the GUI thread, and changes made through the setters are
+ * published back into it.
+ *
+ * NOTIFY signals are not emitted from the setters: changes are folded by a
+ * ChangeNotifier and each changed property notifies once per frame.
+ */
 class DeviceInfo : public QObject
 {
     Q_OBJECT
@@ -24,15 +44,92 @@ class DeviceInfo : public QObject
     Q_PROPERTY(bool adaptiveModeActive READ adaptiveModeActive NOTIFY noiseControlModeChangedInt)
     Q_PROPERTY(QString podIcon READ podIcon NOTIFY modelChanged)
     Q_PROPERTY(QString caseIcon READ caseIcon NOTIFY modelChanged)
+    // What the model accepts, so QML can hide controls whose commands would not be sent
+    Q_PROPERTY(bool noiseCancellationSupported READ noiseCancellationSupported NOTIFY modelChanged)
+    Q_PROPERTY(bool adaptiveModeSupported READ adaptiveModeSupported NOTIFY modelChanged)
+    Q_PROPERTY(bool conversationalAwarenessSupported READ conversationalAwarenessSupported NOTIFY modelChanged)
+    Q_PROPERTY(bool oneBudANCSupported READ oneBudANCSupported NOTIFY modelChanged)
+    Q_PROPERTY(bool hearingAidSupported READ hearingAidSupported NOTIFY modelChanged)
+    Q_PROPERTY(bool headTrackingSupported READ headTrackingSupported NOTIFY modelChanged)
     Q_PROPERTY(bool leftPodInEar READ isLeftPodInEar NOTIFY primaryChanged)
     Q_PROPERTY(bool rightPodInEar READ isRightPodInEar NOTIFY primaryChanged)
-    Q_PROPERTY(QString bluetoothAddress READ bluetoothAddress WRITE setBluetoothAddress NOTIFY bluetoothAddressChanged)
+    Q_PROPERTY(QString bluetoothAddress READ bluetoothAddressString WRITE setBluetoothAddressString NOTIFY bluetoothAddressChanged)
     Q_PROPERTY(QString magicAccIRK READ magicAccIRKHex CONSTANT)
     Q_PROPERTY(QString magicAccEncKey READ magicAccEncKeyHex CONSTANT)
+    // Minutes until empty, or until full while charging; -1 while unknown
+    Q_PROPERTY(int leftPodMinutes READ leftPodMinutes NOTIFY estimatesChanged)
+    Q_PROPERTY(int rightPodMinutes READ rightPodMinutes NOTIFY estimatesChanged)
+    Q_PROPERTY(int caseMinutes READ caseMinutes NOTIFY estimatesChanged)
+    Q_PROPERTY(int headsetMinutes READ headsetMinutes NOTIFY estimatesChanged)
+    Q_PROPERTY(QString batteryEstimate READ batteryEstimate NOTIFY estimatesChanged)
 
 public:
-    explicit DeviceInfo(QObject *parent = nullptr) : QObject(parent), m_battery(new Battery(this)), m_earDetection(new EarDetection(this)) {
-        connect(getEarDetection(), &EarDetection::statusChanged, this, &DeviceInfo::primaryChanged);
+    // Bits of the propertiesChanged() mask
+    enum Property : ChangeNotifier::Mask
+    {
+        BatteryStatusProperty = 1 << 0,
+        NoiseControlModeProperty = 1 << 1,
+        ConversationalAwarenessProperty = 1 << 2,
+        HearingAidEnabledProperty = 1 << 3,
+        AdaptiveNoiseLevelProperty = 1 << 4,
+        DeviceNameProperty = 1 << 5,
+        OneBudANCModeProperty = 1 << 6,
+        ModelProperty = 1 << 7,
+        BluetoothAddressProperty = 1 << 8,
+        EarDetectionProperty = 1 << 9,
+        BatteryProperty = 1 << 10, // Battery levels; batteryStatus is derived from them when notifying
+        EstimatesProperty = 1 << 11,
+    };
+
+    static constexpr int NOTIFY_INTERVAL_MS = 16;
+
+    explicit DeviceInfo(QObject *parent = nullptr)
+        : QObject(parent), m_battery(new Battery(this)), m_earDetection(new EarDetection(this)), m_notifier(new ChangeNotifier(this))
+    {
+        m_notifier->setInterval(NOTIFY_INTERVAL_MS);
+        connect(m_notifier, &ChangeNotifier::changed, this, &DeviceInfo::notifyChanges);
+        connect(getEarDetection(), &EarDetection::statusChanged, this, [this]()
+        {
+            publish([this](DeviceState &state)
+            {
+                state.primaryEar = m_earDetection->getprimaryStatus();
+                state.secondaryEar = m_earDetection->getsecondaryStatus();
+            });
+        });
+        connect(getEarDetection(), &EarDetection::statusChanged, this, [this]() { m_notifier->markDirty(EarDetectionProperty); });
+        auto publishBattery = [this]()
+        {
+            publish([this](DeviceState &state)
+            {
+                state.battery = m_battery->componentStates();
+                state.primaryPod = m_battery->getPrimaryPod();
+            });
+            m_notifier->markDirty(BatteryProperty);
+        };
+        connect(m_battery, &Battery::batteryStatusChanged, this, publishBattery);
+        connect(m_battery, &Battery::primaryChanged, this, publishBattery);
+        connect(m_battery, &Battery::batteryStatusChanged, this, &DeviceInfo::sampleBattery);
+    }
+
+    // Consistent copy of the device state; safe to call from any thread
+    DeviceState snapshot() const { return m_state.load(); }
+    quint64 stateGeneration() const { return m_state.generation(); }
+
+    const ChangeNotifier::Stats &notificationStats() const { return m_notifier->stats(); }
+
+    /**
+     * @brief Changes the device state from any thread
+     *
+     * The properties catch up on the GUI thread. Updates made before it gets
+     * there are applied together.
+     */
+    template <typename Fn>
+    void updateState(Fn &&fn)
+    {
+        if (m_state.update(std::forward<Fn>(fn)) && !m_applyPending.exchange(true, std::memory_order_acq_rel))
+        {
+            QMetaObject::invokeMethod(this, &DeviceInfo::applyState, Qt::QueuedConnection);
+        }
     }
 
     QString batteryStatus() const { return m_batteryStatus; }
@@ -41,7 +138,7 @@ public:
         if (m_batteryStatus != status)
         {
             m_batteryStatus = status;
-            emit batteryStatusChanged(status);
+            m_notifier->markDirty(BatteryStatusProperty);
         }
     }
 
@@ -51,8 +148,8 @@ public:
         if (m_noiseControlMode != mode)
         {
             m_noiseControlMode = mode;
-            emit noiseControlModeChanged(mode);
-            emit noiseControlModeChangedInt(static_cast<int>(mode));
+            publish([mode](DeviceState &state) { state.noiseControlMode = mode; });
+            m_notifier->markDirty(NoiseControlModeProperty | EstimatesProperty);
         }
     }
     int noiseControlModeInt() const { return static_cast<int>(noiseControlMode()); }
@@ -64,7 +161,8 @@ public:
         if (m_conversationalAwareness != enabled)
         {
             m_conversationalAwareness = enabled;
-            emit conversationalAwarenessChanged(enabled);
+            publish([enabled](DeviceState &state) { state.conversationalAwareness = enabled; });
+            m_notifier->markDirty(ConversationalAwarenessProperty);
         }
     }
 
@@ -74,7 +172,8 @@ public:
         if (m_hearingAidEnabled != enabled)
         {
             m_hearingAidEnabled = enabled;
-            emit hearingAidEnabledChanged(enabled);
+            publish([enabled](DeviceState &state) { state.hearingAidEnabled = enabled; });
+            m_notifier->markDirty(HearingAidEnabledProperty);
         }
     }
 
@@ -84,7 +183,8 @@ public:
         if (m_adaptiveNoiseLevel != level)
         {
             m_adaptiveNoiseLevel = level;
-            emit adaptiveNoiseLevelChanged(level);
+            publish([level](DeviceState &state) { state.adaptiveNoiseLevel = level; });
+            m_notifier->markDirty(AdaptiveNoiseLevelProperty);
         }
     }
 
@@ -94,7 +194,7 @@ public:
         if (m_deviceName != name)
         {
             m_deviceName = name;
-            emit deviceNameChanged(name);
+            m_notifier->markDirty(DeviceNameProperty);
         }
     }
 
@@ -106,7 +206,8 @@ public:
         if (m_oneBudANCMode != enabled)
         {
             m_oneBudANCMode = enabled;
-            emit oneBudANCModeChanged(enabled);
+            publish([enabled](DeviceState &state) { state.oneBudANCMode = enabled; });
+            m_notifier->markDirty(OneBudANCModeProperty);
         }
     }
 
@@ -116,36 +217,58 @@ public:
         if (m_model != model)
         {
             m_model = model;
-            emit modelChanged();
+            publish([model](DeviceState &state) { state.model = model; });
+            m_notifier->markDirty(ModelProperty);
         }
     }
 
     QByteArray magicAccIRK() const { return m_magicAccIRK; }
-    void setMagicAccIRK(const QByteArray &irk) { m_magicAccIRK = irk; }
+    void setMagicAccIRK(const QByteArray &irk)
+    {
+        m_magicAccIRK = irk;
+        m_irkContext = IrkContext(irk); // Key schedule is computed once here
+    }
     QString magicAccIRKHex() const { return QString::fromUtf8(m_magicAccIRK.toHex()); }
 
     QByteArray magicAccEncKey() const { return m_magicAccEncKey; }
-    void setMagicAccEncKey(const QByteArray &key) { m_magicAccEncKey = key; }
+    void setMagicAccEncKey(const QByteArray &key)
+    {
+        m_magicAccEncKey = key;
+        m_encKeyContext = EncKeyContext(key);
+    }
     QString magicAccEncKeyHex() const { return QString::fromUtf8(m_magicAccEncKey.toHex()); }
 
+    const IrkContext &irkContext() const { return m_irkContext; }
+    EncKeyContext &encKeyContext() { return m_encKeyContext; }
+
     QString modelNumber() const { return m_modelNumber; }
     void setModelNumber(const QString &modelNumber) { m_modelNumber = modelNumber; }
 
     QString manufacturer() const { return m_manufacturer; }
     void setManufacturer(const QString &manufacturer) { m_manufacturer = manufacturer; }
 
-    QString bluetoothAddress() const { return m_bluetoothAddress; }
-    void setBluetoothAddress(const QString &address)
+    BluetoothAddress bluetoothAddress() const { return m_bluetoothAddress; }
+    void setBluetoothAddress(BluetoothAddress address)
     {
         if (m_bluetoothAddress != address)
         {
             m_bluetoothAddress = address;
-            emit bluetoothAddressChanged(address);
+            publish([address](DeviceState &state) { state.address = address; });
+            m_notifier->markDirty(BluetoothAddressProperty);
         }
     }
+    QString bluetoothAddressString() const { return m_bluetoothAddress.isNull() ? QString() : m_bluetoothAddress.toString(); }
+    void setBluetoothAddressString(const QString &address) { setBluetoothAddress(BluetoothAddress::fromString(address)); }
 
-    QString podIcon() const { return getModelIcon(model()).first; }
-    QString caseIcon() const { return getModelIcon(model()).second; }
+    QString podIcon() const { return DeviceCatalog::entry(model()).podIconName(); }
+    QString caseIcon() const { return DeviceCatalog::entry(model()).caseIconName(); }
+    bool supports(DeviceCatalog::Feature feature) const { return DeviceCatalog::entry(model()).supports(feature); }
+    bool noiseCancellationSupported() const { return supports(DeviceCatalog::NoiseCancellation); }
+    bool adaptiveModeSupported() const { return supports(DeviceCatalog::AdaptiveMode); }
+    bool conversationalAwarenessSupported() const { return supports(DeviceCatalog::ConversationalAwareness); }
+    bool oneBudANCSupported() const { return supports(DeviceCatalog::OneBudANC); }
+    bool hearingAidSupported() const { return supports(DeviceCatalog::HearingAid); }
+    bool headTrackingSupported() const { return supports(DeviceCatalog::HeadTracking); }
     bool isLeftPodInEar() const
     {
         if (getBattery()->getPrimaryPod() == Battery::Component::Left) return getEarDetection()->isPrimaryInEar();
@@ -159,6 +282,67 @@ public:
 
     bool adaptiveModeActive() const { return noiseControlMode() == NoiseControlMode::Adaptive; }
 
+    // Media playback drains the buds faster, so estimates are kept apart for it
+    bool mediaPlaying() const { return m_mediaPlaying; }
+    void setMediaPlaying(bool playing)
+    {
+        if (m_mediaPlaying != playing)
+        {
+            m_mediaPlaying = playing;
+            m_notifier->markDirty(EstimatesProperty);
+        }
+    }
+
+    // Minutes until empty, or until full while charging; -1 while unknown
+    int estimatedMinutes(Battery::Component component) const
+    {
+        const Battery::BatteryState state = m_battery->getState(component);
+        switch (state.status)
+        {
+        case Battery::BatteryStatus::Charging:
+            return m_predictor.minutesToFull(component, state.level);
+        case Battery::BatteryStatus::Discharging:
+            return m_predictor.minutesRemaining(component, state.level, m_noiseControlMode, m_mediaPlaying);
+        default:
+            return -1;
+        }
+    }
+    int leftPodMinutes() const { return estimatedMinutes(Battery::Component::Left); }
+    int rightPodMinutes() const { return estimatedMinutes(Battery::Component::Right); }
+    int caseMinutes() const { return estimatedMinutes(Battery::Component::Case); }
+    int headsetMinutes() const { return estimatedMinutes(Battery::Component::Headset); }
+
+    // Summary for the buds or headset, e.g. "About 3 h 20 min left"; empty while unknown
+    QString batteryEstimate() const
+    {
+        const bool headset = m_battery->getPrimaryPod() == Battery::Component::Headset;
+        const bool charging = headset ? m_battery->isHeadsetCharging()
+                                      : m_battery->isLeftPodCharging() || m_battery->isRightPodCharging();
+        int minutes = -1;
+        for (Battery::Component component : {Battery::Component::Left, Battery::Component::Right, Battery::Component::Headset})
+        {
+            const Battery::BatteryState state = m_battery->getState(component);
+            if ((component == Battery::Component::Headset) != headset
+                || (state.status == Battery::BatteryStatus::Charging) != charging)
+            {
+                continue;
+            }
+            // The first bud to run out, or the last one to fill up
+            const int estimate = estimatedMinutes(component);
+            if (estimate >= 0 && (minutes < 0 || (charging ? estimate > minutes : estimate < minutes)))
+            {
+                minutes = estimate;
+            }
+        }
+        if (minutes < 0)
+        {
+            return QString();
+        }
+        const QString duration = minutes >= 60 ? QString("%1 h %2 min").arg(minutes / 60).arg(minutes % 60)
+                                               : QString("%1 min").arg(minutes);
+        return charging ? QString("Full in about %1").arg(duration) : QString("About %1 left").arg(duration);
+    }
+
     EarDetection *getEarDetection() const { return m_earDetection; }
 
     void reset()
@@ -168,9 +352,10 @@ public:
         m_battery->reset();
         setBatteryStatus("");
         setNoiseControlMode(NoiseControlMode::Off);
-        setBluetoothAddress("");
+        setBluetoothAddress(BluetoothAddress());
         getEarDetection()->reset();
         setHearingAidEnabled(false);
+        m_predictor.resetAnchors();
     }
 
     void saveToSettings(QSettings &settings)
@@ -192,17 +377,22 @@ public:
         setHearingAidEnabled(settings.value("DeviceInfo/hearingAidEnabled", false).toBool());
     }
 
-    void updateBatteryStatus()
+    // Summary shown in the tray, empty while no component is connected
+    QString batteryStatusText() const
     {
-        int leftLevel = getBattery()->getState(Battery::Component::Left).level;
-        int rightLevel = getBattery()->getState(Battery::Component::Right).level;
-        int caseLevel = getBattery()->getState(Battery::Component::Case).level;
-        if (getBattery()->getPrimaryPod() == Battery::Component::Headset) {
-            int headsetLevel = getBattery()->getState(Battery::Component::Headset).level;
-            setBatteryStatus(QString("Headset: %1%").arg(headsetLevel));
-        } else {
-            setBatteryStatus(QString("Left: %1%, Right: %2%, Case: %3%").arg(leftLevel).arg(rightLevel).arg(caseLevel));
+        const Battery *battery = getBattery();
+        if (!battery->isLeftPodAvailable() && !battery->isRightPodAvailable() && !battery->isCaseAvailable() && !battery->isHeadsetAvailable())
+        {
+            return QString();
+        }
+        int leftLevel = battery->getState(Battery::Component::Left).level;
+        int rightLevel = battery->getState(Battery::Component::Right).level;
+        int caseLevel = battery->getState(Battery::Component::Case).level;
+        if (battery->getPrimaryPod() == Battery::Component::Headset) {
+            int headsetLevel = battery->getState(Battery::Component::Headset).level;
+            return QString("Headset: %1%").arg(headsetLevel);
         }
+        return QString("Left: %1%, Right: %2%, Case: %3%").arg(leftLevel).arg(rightLevel).arg(caseLevel);
     }
 
 signals:
@@ -216,9 +406,106 @@ signals:
     void primaryChanged();
     void oneBudANCModeChanged(bool enabled);
     void modelChanged();
-    void bluetoothAddressChanged(const QString &address);
+    void bluetoothAddressChanged();
+    void estimatesChanged();
+    // Emitted once per flush after the individual NOTIFY signals; foldedChanges counts the raw changes behind it
+    void propertiesChanged(quint32 properties, int foldedChanges);
+    // The properties have caught up with a state published by updateState()
+    void stateApplied(quint64 generation);
 
 private:
+    // Mirrors a change made through a setter; skipped while applyState() drives the setters
+    template <typename Fn>
+    void publish(Fn &&fn)
+    {
+        if (!m_applying)
+        {
+            m_state.update(std::forward<Fn>(fn));
+        }
+    }
+
+    // Feeds the components changed by the last battery update to the predictor
+    void sampleBattery()
+    {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (Battery::Component component : {Battery::Component::Left, Battery::Component::Right,
+                                             Battery::Component::Case, Battery::Component::Headset})
+        {
+            const Battery::BatteryState state = m_battery->getState(component);
+            if ((m_battery->lastChangeMask() & static_cast<Battery::ChangeMask>(component))
+                && state.status != Battery::BatteryStatus::Disconnected)
+            {
+                m_predictor.addSample(component, state.level, state.status == Battery::BatteryStatus::Charging, now,
+                                      m_noiseControlMode, m_mediaPlaying);
+            }
+        }
+        m_notifier->markDirty(EstimatesProperty);
+    }
+
+    void notifyChanges(ChangeNotifier::Mask properties, int foldedChanges)
+    {
+        // The summary is formatted once per flush rather than once per battery packet
+        if (properties & BatteryProperty)
+        {
+            QString status = batteryStatusText();
+            if (status != m_batteryStatus)
+            {
+                m_batteryStatus = status;
+                properties |= BatteryStatusProperty;
+            }
+        }
+
+        if (properties & BatteryStatusProperty)
+            emit batteryStatusChanged(m_batteryStatus);
+        if (properties & NoiseControlModeProperty)
+        {
+            emit noiseControlModeChanged(m_noiseControlMode);
+            emit noiseControlModeChangedInt(static_cast<int>(m_noiseControlMode));
+        }
+        if (properties & ConversationalAwarenessProperty)
+            emit conversationalAwarenessChanged(m_conversationalAwareness);
+        if (properties & HearingAidEnabledProperty)
+            emit hearingAidEnabledChanged(m_hearingAidEnabled);
+        if (properties & AdaptiveNoiseLevelProperty)
+            emit adaptiveNoiseLevelChanged(m_adaptiveNoiseLevel);
+        if (properties & DeviceNameProperty)
+            emit deviceNameChanged(m_deviceName);
+        if (properties & OneBudANCModeProperty)
+            emit oneBudANCModeChanged(m_oneBudANCMode);
+        if (properties & ModelProperty)
+            emit modelChanged();
+        if (properties & BluetoothAddressProperty)
+            emit bluetoothAddressChanged();
+        if (properties & EarDetectionProperty)
+            emit primaryChanged();
+        if (properties & EstimatesProperty)
+            emit estimatesChanged();
+
+        emit propertiesChanged(properties, foldedChanges);
+    }
+
+    void applyState()
+    {
+        // Cleared first, so an update racing with the load below queues another call
+        m_applyPending.store(false, std::memory_order_release);
+        quint64 generation = 0;
+        const DeviceState state = m_state.load(&generation);
+
+        m_applying = true;
+        m_battery->setComponentStates(state.battery, state.primaryPod);
+        m_earDetection->setStatus(state.primaryEar, state.secondaryEar);
+        setNoiseControlMode(state.noiseControlMode);
+        setConversationalAwareness(state.conversationalAwareness);
+        setHearingAidEnabled(state.hearingAidEnabled);
+        setAdaptiveNoiseLevel(state.adaptiveNoiseLevel);
+        setOneBudANCMode(state.oneBudANCMode);
+        setModel(state.model);
+        setBluetoothAddress(state.address);
+        m_applying = false;
+
+        emit stateApplied(generation);
+    }
+
     QString m_batteryStatus;
     NoiseControlMode m_noiseControlMode = NoiseControlMode::Transparency;
     bool m_conversationalAwareness = false;
@@ -228,10 +515,18 @@ private:
     Battery *m_battery;
     QByteArray m_magicAccIRK;
     QByteArray m_magicAccEncKey;
+    IrkContext m_irkContext;
+    EncKeyContext m_encKeyContext;
     bool m_oneBudANCMode = false;
     AirPodsModel m_model = AirPodsModel::Unknown;
     QString m_modelNumber;
     QString m_manufacturer;
-    QString m_bluetoothAddress;
+    BluetoothAddress m_bluetoothAddress;
     EarDetection *m_earDetection;
+    ChangeNotifier *m_notifier;
+    BatteryPredictor m_predictor;
+    bool m_mediaPlaying = false;
+    SeqLock<DeviceState> m_state;
+    std::atomic<bool> m_applyPending{false};
+    bool m_applying = false; // GUI thread only
 };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QtGlobal>
+#include <type_traits>
+#include "battery.hpp"
+#include "bluetoothaddress.h"
+#include "eardetection.hpp"
+#include "enums.h"
+
+/**
+ * @brief Plain copy of everything known about the connected device.
+ *
+ * Published through a SeqLock by DeviceInfo, so any thread can read a
+ * consistent snapshot. Strings and keys stay on DeviceInfo; they change rarely
+ * and would make the struct non-trivial.
+ */
+struct DeviceState
+{
+    Battery::States battery{};
+    Battery::Component primaryPod = Battery::Component::Left;
+    EarDetection::EarDetectionStatus primaryEar = EarDetection::EarDetectionStatus::Disconnected;
+    EarDetection::EarDetectionStatus secondaryEar = EarDetection::EarDetectionStatus::Disconnected;
+    AirpodsTrayApp::Enums::NoiseControlMode noiseControlMode = AirpodsTrayApp::Enums::NoiseControlMode::Transparency;
+    AirpodsTrayApp::Enums::AirPodsModel model = AirpodsTrayApp::Enums::AirPodsModel::Unknown;
+    BluetoothAddress address;
+    qint32 adaptiveNoiseLevel = 50;
+    bool conversationalAwareness = false;
+    bool hearingAidEnabled = false;
+    bool oneBudANCMode = false;
+};
+
+static_assert(std::is_trivially_copyable_v<DeviceState>, "DeviceState is published word by word");
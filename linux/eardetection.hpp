@@ -50,8 +50,26 @@ public:
     }
     void overrideEarDetectionStatus(bool primaryInEar, bool secondaryInEar)
     {
-        primaryStatus = primaryInEar ? EarDetectionStatus::InEar : EarDetectionStatus::NotInEar;
-        secondaryStatus = secondaryInEar ? EarDetectionStatus::InEar : EarDetectionStatus::NotInEar;
+        auto newPrimaryStatus = primaryInEar ? EarDetectionStatus::InEar : EarDetectionStatus::NotInEar;
+        auto newSecondaryStatus = secondaryInEar ? EarDetectionStatus::InEar : EarDetectionStatus::NotInEar;
+        if (newPrimaryStatus == primaryStatus && newSecondaryStatus == secondaryStatus)
+        {
+            m_skippedNotifications++;
+            return;
+        }
+        primaryStatus = newPrimaryStatus;
+        secondaryStatus = newSecondaryStatus;
+        emit statusChanged();
+    }
+
+    void setStatus(EarDetectionStatus newPrimaryStatus, EarDetectionStatus newSecondaryStatus)
+    {
+        if (newPrimaryStatus == primaryStatus && newSecondaryStatus == secondaryStatus)
+        {
+            return;
+        }
+        primaryStatus = newPrimaryStatus;
+        secondaryStatus = newSecondaryStatus;
         emit statusChanged();
     }
 
@@ -62,6 +80,7 @@ public:
 
     EarDetectionStatus getprimaryStatus() const { return primaryStatus; }
     EarDetectionStatus getsecondaryStatus() const { return secondaryStatus; }
+    quint64 skippedNotifications() const { return m_skippedNotifications; }
 
 signals:
     void statusChanged();
@@ -91,4 +110,5 @@ private:
 
     EarDetectionStatus primaryStatus = EarDetectionStatus::Disconnected;
     EarDetectionStatus secondaryStatus = EarDetectionStatus::Disconnected;
+    quint64 m_skippedNotifications = 0; // Overrides that repeated the current status
 };
\ No newline at end of file
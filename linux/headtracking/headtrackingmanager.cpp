@@ -0,0 +1,275 @@
+#include "headtrackingmanager.h"
+#include "airpods_packets.h"
+#include "logger.h"
+
+#include <QtEndian>
+
+namespace
+{
+    // Offsets of the sensor fields, see "Received Head Tracking Sensor Data" in AAP Definitions.md
+    constexpr int SEQUENCE_OFFSET = 12;
+    constexpr int ORIENTATION1_OFFSET = 43;
+    constexpr int ORIENTATION2_OFFSET = 45;
+    constexpr int ORIENTATION3_OFFSET = 47;
+    constexpr int HORIZONTAL_ACCEL_OFFSET = 51;
+    constexpr int VERTICAL_ACCEL_OFFSET = 53;
+
+    constexpr int START_RETRY_MS = 1000;
+
+    qint16 readInt16(const QByteArray &data, int offset)
+    {
+        return qFromLittleEndian<qint16>(data.constData() + offset);
+    }
+}
+
+bool HeadTrackingSample::parse(const QByteArray &data, HeadTrackingSample &sample)
+{
+    if (!AirPodsPackets::HeadTracking::isSensorPacket(data))
+    {
+        return false;
+    }
+
+    sample.sequence = qFromLittleEndian<quint16>(data.constData() + SEQUENCE_OFFSET);
+    sample.orientation1 = readInt16(data, ORIENTATION1_OFFSET);
+    sample.orientation2 = readInt16(data, ORIENTATION2_OFFSET);
+    sample.orientation3 = readInt16(data, ORIENTATION3_OFFSET);
+    sample.horizontalAcceleration = readInt16(data, HORIZONTAL_ACCEL_OFFSET);
+    sample.verticalAcceleration = readInt16(data, VERTICAL_ACCEL_OFFSET);
+    return true;
+}
+
+HeadTrackingSubscription::HeadTrackingSubscription(HeadTrackingManager *manager, const QString &consumer, int decimation)
+    : QObject(nullptr), m_manager(manager), m_consumer(consumer), m_decimation(qMax(1, decimation))
+{
+}
+
+HeadTrackingSubscription::~HeadTrackingSubscription()
+{
+    release();
+}
+
+void HeadTrackingSubscription::setDecimation(int decimation)
+{
+    decimation = qMax(1, decimation);
+    if (m_decimation != decimation)
+    {
+        m_decimation = decimation;
+        m_phase = 0;
+        emit decimationChanged(decimation);
+    }
+}
+
+void HeadTrackingSubscription::release()
+{
+    if (m_manager)
+    {
+        m_manager->unsubscribe(this);
+        m_manager.clear();
+        emit activeChanged();
+    }
+}
+
+void HeadTrackingSubscription::deliver(const HeadTrackingSample &sample)
+{
+    if (++m_phase < m_decimation)
+    {
+        m_skipped++;
+        return;
+    }
+    m_phase = 0;
+    m_delivered++;
+    emit sampleReceived(sample);
+}
+
+HeadTrackingManager::HeadTrackingManager(PacketWriter writer, QObject *parent)
+    : QObject(parent), m_writer(std::move(writer))
+{
+    m_startRetry.setSingleShot(true);
+    m_startRetry.setInterval(START_RETRY_MS);
+    connect(&m_startRetry, &QTimer::timeout, this, &HeadTrackingManager::updateStreamState);
+    m_clock.start();
+}
+
+HeadTrackingManager::~HeadTrackingManager()
+{
+    // Subscriptions are owned by their consumers, just detach them
+    const auto subscriptions = m_subscriptions;
+    m_subscriptions.clear();
+    for (HeadTrackingSubscription *subscription : subscriptions)
+    {
+        subscription->m_manager.clear();
+    }
+}
+
+HeadTrackingSubscription *HeadTrackingManager::subscribe(const QString &consumer, int decimation)
+{
+    auto *subscription = new HeadTrackingSubscription(this, consumer, decimation);
+    m_subscriptions.append(subscription);
+    LOG_DEBUG("Head tracking consumer subscribed: " << consumer << " (decimation " << subscription->decimation() << ")");
+    emit consumerCountChanged(m_subscriptions.size());
+    updateStreamState();
+    return subscription;
+}
+
+void HeadTrackingManager::unsubscribe(HeadTrackingSubscription *subscription)
+{
+    if (!m_subscriptions.removeOne(subscription))
+    {
+        return;
+    }
+    LOG_DEBUG("Head tracking consumer released: " << subscription->consumer());
+    emit consumerCountChanged(m_subscriptions.size());
+    updateStreamState();
+}
+
+void HeadTrackingManager::setLinkAvailable(bool available)
+{
+    if (!available && !m_linkAvailable)
+    {
+        return;
+    }
+
+    accountElapsed();
+    m_linkAvailable = available;
+    if (m_streaming)
+    {
+        // The stream dies with the old link, no need to send Stop Tracking
+        m_streaming = false;
+        emit streamingChanged(false);
+    }
+    updateStreamState();
+}
+
+void HeadTrackingManager::setSupported(bool supported)
+{
+    if (m_supported == supported)
+    {
+        return;
+    }
+    m_supported = supported;
+    updateStreamState();
+}
+
+void HeadTrackingManager::updateStreamState()
+{
+    bool wanted = m_linkAvailable && m_supported && !m_subscriptions.isEmpty();
+    if (!wanted)
+    {
+        m_startRetry.stop();
+    }
+    if (wanted == m_streaming)
+    {
+        return;
+    }
+
+    accountElapsed();
+    if (wanted)
+    {
+        if (!m_writer(AirPodsPackets::HeadTracking::START, "Start head tracking packet written: "))
+        {
+            // Not streaming yet, try again while someone still wants the data
+            LOG_WARN("Failed to send Start head tracking, retrying in " << START_RETRY_MS << " ms");
+            m_startRetry.start();
+            return;
+        }
+        m_stats.startCommands++;
+    }
+    else
+    {
+        m_writer(AirPodsPackets::HeadTracking::STOP, "Stop head tracking packet written: ");
+        m_stats.stopCommands++;
+        LinkStats stats = linkStats();
+        LOG_INFO("Head tracking stopped: " << stats.packetsReceived << " packets, "
+                 << stats.streamingMs << " ms streaming, ~" << stats.bytesSaved << " bytes saved while idle");
+    }
+
+    m_streaming = wanted;
+    emit streamingChanged(m_streaming);
+}
+
+bool HeadTrackingManager::handlePacket(const QByteArray &data)
+{
+    HeadTrackingSample sample;
+    if (!HeadTrackingSample::parse(data, sample))
+    {
+        return false;
+    }
+
+    m_stats.packetsReceived++;
+    m_stats.bytesReceived += data.size();
+    sample.timestampMs = m_clock.elapsed();
+
+    // Iterate over a copy, consumers may release their handle from the slot
+    const auto subscriptions = m_subscriptions;
+    for (HeadTrackingSubscription *subscription : subscriptions)
+    {
+        if (!m_subscriptions.contains(subscription))
+        {
+            continue;
+        }
+        quint64 delivered = subscription->deliveredSamples();
+        subscription->deliver(sample);
+        if (subscription->deliveredSamples() != delivered)
+        {
+            m_stats.samplesDelivered++;
+        }
+        else
+        {
+            m_stats.samplesDecimated++;
+        }
+    }
+    return true;
+}
+
+void HeadTrackingManager::accountElapsed()
+{
+    qint64 now = m_clock.elapsed();
+    qint64 elapsed = now - m_lastAccountedMs;
+    m_lastAccountedMs = now;
+
+    if (m_streaming)
+    {
+        m_stats.streamingMs += elapsed;
+    }
+    else if (m_linkAvailable)
+    {
+        m_stats.idleMs += elapsed;
+    }
+}
+
+HeadTrackingManager::LinkStats HeadTrackingManager::linkStats() const
+{
+    LinkStats stats = m_stats;
+    qint64 pending = m_clock.elapsed() - m_lastAccountedMs;
+    if (m_streaming)
+    {
+        stats.streamingMs += pending;
+    }
+    else if (m_linkAvailable)
+    {
+        stats.idleMs += pending;
+    }
+
+    if (stats.streamingMs > 0)
+    {
+        double bytesPerMs = static_cast<double>(stats.bytesReceived) / stats.streamingMs;
+        stats.bytesSaved = static_cast<quint64>(bytesPerMs * stats.idleMs);
+    }
+    return stats;
+}
+
+QVariantMap HeadTrackingManager::linkStatistics() const
+{
+    LinkStats stats = linkStats();
+    return {
+        {"packetsReceived", stats.packetsReceived},
+        {"bytesReceived", stats.bytesReceived},
+        {"samplesDelivered", stats.samplesDelivered},
+        {"samplesDecimated", stats.samplesDecimated},
+        {"startCommands", stats.startCommands},
+        {"stopCommands", stats.stopCommands},
+        {"streamingMs", stats.streamingMs},
+        {"idleMs", stats.idleMs},
+        {"bytesSaved", stats.bytesSaved},
+    };
+}
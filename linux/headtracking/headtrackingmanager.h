@@ -0,0 +1,157 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+#include <QVariantMap>
+#include <functional>
+
+// A single decoded head tracking sensor packet
+struct HeadTrackingSample
+{
+    Q_GADGET
+    Q_PROPERTY(int sequence MEMBER sequence)
+    Q_PROPERTY(int orientation1 MEMBER orientation1)
+    Q_PROPERTY(int orientation2 MEMBER orientation2)
+    Q_PROPERTY(int orientation3 MEMBER orientation3)
+    Q_PROPERTY(int horizontalAcceleration MEMBER horizontalAcceleration)
+    Q_PROPERTY(int verticalAcceleration MEMBER verticalAcceleration)
+
+public:
+    int sequence = 0;
+    int orientation1 = 0;
+    int orientation2 = 0;
+    int orientation3 = 0;
+    int horizontalAcceleration = 0;
+    int verticalAcceleration = 0;
+    qint64 timestampMs = 0; // Monotonic, relative to the manager's clock
+
+    static bool parse(const QByteArray &data, HeadTrackingSample &sample);
+};
+
+class HeadTrackingManager;
+
+/**
+ * @brief Handle held by a consumer of head tracking data.
+ *
+ * Sensor data is streamed from the AirPods only while at least one handle is
+ * alive. Destroying the handle (or calling release()) drops the subscription.
+ */
+class HeadTrackingSubscription : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString consumer READ consumer CONSTANT)
+    Q_PROPERTY(int decimation READ decimation WRITE setDecimation NOTIFY decimationChanged)
+    Q_PROPERTY(bool active READ isActive NOTIFY activeChanged)
+
+public:
+    ~HeadTrackingSubscription() override;
+
+    QString consumer() const { return m_consumer; }
+
+    // Only every n-th sample is delivered to this consumer
+    int decimation() const { return m_decimation; }
+    void setDecimation(int decimation);
+
+    bool isActive() const { return !m_manager.isNull(); }
+
+    quint64 deliveredSamples() const { return m_delivered; }
+    quint64 skippedSamples() const { return m_skipped; }
+
+public slots:
+    void release();
+
+signals:
+    void sampleReceived(const HeadTrackingSample &sample);
+    void decimationChanged(int decimation);
+    void activeChanged();
+
+private:
+    friend class HeadTrackingManager;
+    HeadTrackingSubscription(HeadTrackingManager *manager, const QString &consumer, int decimation);
+
+    void deliver(const HeadTrackingSample &sample);
+
+    QPointer<HeadTrackingManager> m_manager;
+    QString m_consumer;
+    int m_decimation = 1;
+    int m_phase = 0;
+    quint64 m_delivered = 0;
+    quint64 m_skipped = 0;
+};
+
+/**
+ * @brief Reference counts head tracking consumers and drives the sensor stream.
+ *
+ * The Start Tracking packet is written when the first subscription appears
+ * (or the link comes up with subscriptions pending) and Stop Tracking when the
+ * last one goes away, so the AirPods never stream data nobody reads.
+ */
+class HeadTrackingManager : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool streaming READ isStreaming NOTIFY streamingChanged)
+    Q_PROPERTY(int consumerCount READ consumerCount NOTIFY consumerCountChanged)
+
+public:
+    using PacketWriter = std::function<bool(const QByteArray &packet, const QString &logMessage)>;
+
+    struct LinkStats
+    {
+        quint64 packetsReceived = 0;
+        quint64 bytesReceived = 0;
+        quint64 samplesDelivered = 0;
+        quint64 samplesDecimated = 0;
+        quint64 startCommands = 0;
+        quint64 stopCommands = 0;
+        qint64 streamingMs = 0;
+        qint64 idleMs = 0;        // Link up, nobody subscribed
+        quint64 bytesSaved = 0;   // Estimated from the observed stream rate over idleMs
+    };
+
+    explicit HeadTrackingManager(PacketWriter writer, QObject *parent = nullptr);
+    ~HeadTrackingManager() override;
+
+    Q_INVOKABLE HeadTrackingSubscription *subscribe(const QString &consumer, int decimation = 1);
+
+    // Called when the AAP link becomes usable or goes away. A new link starts
+    // without a stream, so pending subscriptions get Start Tracking again.
+    void setLinkAvailable(bool available);
+
+    // Models without head tracking are never sent Start Tracking, subscriptions just stay idle
+    void setSupported(bool supported);
+
+    // Returns true if the packet was a head tracking sensor packet
+    bool handlePacket(const QByteArray &data);
+
+    bool isStreaming() const { return m_streaming; }
+    int consumerCount() const { return m_subscriptions.size(); }
+
+    LinkStats linkStats() const;
+    Q_INVOKABLE QVariantMap linkStatistics() const;
+
+signals:
+    void streamingChanged(bool streaming);
+    void consumerCountChanged(int count);
+
+private:
+    friend class HeadTrackingSubscription;
+    void unsubscribe(HeadTrackingSubscription *subscription);
+    void updateStreamState();
+    void accountElapsed();
+
+    PacketWriter m_writer;
+    QList<HeadTrackingSubscription *> m_subscriptions;
+    bool m_linkAvailable = false;
+    bool m_supported = true; // Until the model is known
+    bool m_streaming = false;
+    QTimer m_startRetry; // Start Tracking could not be written
+
+    QElapsedTimer m_clock;
+    qint64 m_lastAccountedMs = 0;
+    LinkStats m_stats;
+};
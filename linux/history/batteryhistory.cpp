@@ -0,0 +1,331 @@
+#include "batteryhistory.h"
+#include "logger.h"
+#include <QDateTime>
+#include <QMap>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+QVector<QPointF> downsampleLttb(const QVector<QPointF> &points, int threshold)
+{
+    const int count = static_cast<int>(points.size());
+    if (threshold >= count || threshold < 3)
+    {
+        return points;
+    }
+
+    QVector<QPointF> sampled;
+    sampled.reserve(threshold);
+    sampled.append(points.first());
+
+    // The first and last point are kept, the rest is split into threshold - 2 buckets
+    const double bucketSize = static_cast<double>(count - 2) / (threshold - 2);
+    int previous = 0;
+    for (int bucket = 0; bucket < threshold - 2; ++bucket)
+    {
+        // Average of the next bucket is the third corner of the triangle
+        const int nextStart = static_cast<int>(std::floor((bucket + 1) * bucketSize)) + 1;
+        const int nextEnd = std::min(static_cast<int>(std::floor((bucket + 2) * bucketSize)) + 1, count);
+        double averageX = 0;
+        double averageY = 0;
+        for (int i = nextStart; i < nextEnd; ++i)
+        {
+            averageX += points[i].x();
+            averageY += points[i].y();
+        }
+        const int nextSize = std::max(1, nextEnd - nextStart);
+        averageX /= nextSize;
+        averageY /= nextSize;
+
+        const int start = static_cast<int>(std::floor(bucket * bucketSize)) + 1;
+        const int end = static_cast<int>(std::floor((bucket + 1) * bucketSize)) + 1;
+        const QPointF &a = points[previous];
+        double largestArea = -1;
+        int selected = start;
+        for (int i = start; i < end; ++i)
+        {
+            // Twice the triangle area, the factor does not change the ranking
+            const double area = std::abs((a.x() - averageX) * (points[i].y() - a.y())
+                                         - (a.x() - points[i].x()) * (averageY - a.y()));
+            if (area > largestArea)
+            {
+                largestArea = area;
+                selected = i;
+            }
+        }
+        sampled.append(points[selected]);
+        previous = selected;
+    }
+
+    sampled.append(points.last());
+    return sampled;
+}
+
+BatteryHistory::BatteryHistory(QObject *parent) : QObject(parent)
+{
+    m_compactPool.setMaxThreadCount(1);
+    m_compactTimer.setInterval(COMPACT_INTERVAL_MS);
+    connect(&m_compactTimer, &QTimer::timeout, this, [this]()
+    {
+        compact(QDateTime::currentMSecsSinceEpoch());
+    });
+}
+
+BatteryHistory::~BatteryHistory()
+{
+    close();
+    // A running compaction posts its result to this object
+    m_compactPool.waitForDone();
+}
+
+bool BatteryHistory::open(const QString &path)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite))
+    {
+        LOG_WARN("Battery history unavailable, cannot open " << path << ": " << m_file.errorString());
+        return false;
+    }
+
+    const bool resized = m_file.size() != FILE_SIZE;
+    if (resized && !m_file.resize(FILE_SIZE))
+    {
+        LOG_WARN("Battery history unavailable, cannot resize " << path << ": " << m_file.errorString());
+        m_file.close();
+        return false;
+    }
+    m_map = m_file.map(0, FILE_SIZE);
+    if (!m_map)
+    {
+        LOG_WARN("Battery history unavailable, cannot map " << path << ": " << m_file.errorString());
+        m_file.close();
+        return false;
+    }
+
+    m_header = reinterpret_cast<Header *>(m_map);
+    m_raw = reinterpret_cast<RawRecord *>(m_map + sizeof(Header));
+    m_hourly = reinterpret_cast<HourlyRecord *>(m_map + sizeof(Header) + RAW_CAPACITY * sizeof(RawRecord));
+
+    if (resized || m_header->magic != MAGIC || m_header->version != VERSION || m_header->rawCapacity != RAW_CAPACITY
+        || m_header->hourlyCapacity != HOURLY_CAPACITY)
+    {
+        LOG_INFO("Starting a new battery history in " << path);
+        std::memset(m_map, 0, FILE_SIZE);
+        m_header->magic = MAGIC;
+        m_header->version = VERSION;
+        m_header->rawCapacity = RAW_CAPACITY;
+        m_header->hourlyCapacity = HOURLY_CAPACITY;
+    }
+
+    compact(QDateTime::currentMSecsSinceEpoch());
+    m_compactTimer.start();
+    return true;
+}
+
+void BatteryHistory::close()
+{
+    m_compactTimer.stop();
+    m_compacting = false;
+    m_generation++;
+    if (m_map)
+    {
+        m_file.unmap(m_map);
+    }
+    m_file.close();
+    m_map = nullptr;
+    m_header = nullptr;
+    m_raw = nullptr;
+    m_hourly = nullptr;
+}
+
+void BatteryHistory::record(Battery::Component component, quint8 level, bool charging, qint64 timestampMs)
+{
+    if (!isOpen())
+    {
+        return;
+    }
+
+    const quint32 timestamp = static_cast<quint32>(std::max<qint64>(0, timestampMs / 1000));
+    m_raw[m_header->rawCount % RAW_CAPACITY] = {timestamp, static_cast<quint8>(component), level,
+                                               static_cast<quint8>(charging), 0};
+    // Published after the record, so a crash never exposes a half-written slot
+    m_header->rawCount++;
+    emit recorded();
+}
+
+void BatteryHistory::compact(qint64 nowMs)
+{
+    if (!isOpen() || m_compacting)
+    {
+        return;
+    }
+    const quint64 first = std::max(m_header->compactedCount, oldestRaw());
+    const quint64 end = m_header->rawCount;
+    if (first == end)
+    {
+        return;
+    }
+
+    // At most one ring of 8-byte records, the pool never reads slots record() may be writing
+    QVector<RawRecord> samples;
+    samples.reserve(static_cast<int>(end - first));
+    for (quint64 i = first; i < end; ++i)
+    {
+        samples.append(raw(i));
+    }
+
+    m_compacting = true;
+    m_compactPool.start([this, samples, first, nowMs, generation = m_generation]()
+    {
+        const Compaction compaction = aggregate(samples, first, nowMs);
+        QMetaObject::invokeMethod(this, [this, compaction, generation]()
+        {
+            applyCompaction(compaction, generation);
+        }, Qt::QueuedConnection);
+    });
+}
+
+BatteryHistory::Compaction BatteryHistory::aggregate(const QVector<RawRecord> &samples, quint64 firstIndex, qint64 nowMs)
+{
+    struct Bucket
+    {
+        quint8 component = 0;
+        quint8 minLevel = 100;
+        quint8 maxLevel = 0;
+        quint32 sum = 0;
+        quint16 samples = 0;
+        quint16 chargingSamples = 0;
+    };
+    // Keyed by hour, a clock that went back can revisit an hour further down the ring
+    QMap<quint32, std::array<Bucket, Battery::COMPONENT_COUNT>> hours;
+
+    const quint32 hourEnd = static_cast<quint32>(nowMs / 1000) / 3600 * 3600;
+    int consumed = 0;
+    for (; consumed < samples.size(); ++consumed)
+    {
+        const RawRecord &sample = samples[consumed];
+        if (sample.timestamp >= hourEnd && sample.timestamp < hourEnd + 3600)
+        {
+            break; // The current hour is not finished, and later samples were recorded after this one
+        }
+        const int index = Battery::componentIndex(static_cast<Battery::Component>(sample.component));
+        if (index < 0)
+        {
+            continue;
+        }
+        if (sample.timestamp >= hourEnd)
+        {
+            continue; // Stamped by a clock that was ahead, it has no finished hour
+        }
+        Bucket &bucket = hours[sample.timestamp / 3600 * 3600][index];
+        bucket.component = sample.component;
+        bucket.minLevel = std::min(bucket.minLevel, sample.level);
+        bucket.maxLevel = std::max(bucket.maxLevel, sample.level);
+        if (bucket.samples < std::numeric_limits<quint16>::max())
+        {
+            bucket.sum += sample.level;
+            bucket.samples++;
+            bucket.chargingSamples += sample.charging ? 1 : 0;
+        }
+    }
+
+    Compaction compaction;
+    compaction.compactedCount = firstIndex + consumed;
+    for (auto it = hours.constBegin(); it != hours.constEnd(); ++it)
+    {
+        for (const Bucket &bucket : it.value())
+        {
+            if (bucket.samples)
+            {
+                compaction.aggregates.append({it.key(), bucket.component, bucket.minLevel, bucket.maxLevel,
+                                              static_cast<quint8>(bucket.sum / bucket.samples), bucket.samples,
+                                              bucket.chargingSamples, 0});
+            }
+        }
+    }
+    return compaction;
+}
+
+void BatteryHistory::applyCompaction(const Compaction &compaction, quint64 generation)
+{
+    if (generation != m_generation || !isOpen())
+    {
+        return;
+    }
+    m_compacting = false;
+    for (const HourlyRecord &aggregate : compaction.aggregates)
+    {
+        m_hourly[m_header->hourlyCount % HOURLY_CAPACITY] = aggregate;
+        m_header->hourlyCount++;
+    }
+    m_header->compactedCount = compaction.compactedCount;
+}
+
+QVector<QPointF> BatteryHistory::series(Battery::Component component, qint64 fromMs, qint64 toMs, int maxPoints) const
+{
+    QVector<QPointF> points;
+    if (!isOpen() || toMs < fromMs)
+    {
+        return points;
+    }
+    const quint32 from = static_cast<quint32>(std::max<qint64>(0, fromMs / 1000));
+    const quint32 to = static_cast<quint32>(std::min<qint64>(std::numeric_limits<quint32>::max(), toMs / 1000));
+    const quint8 wanted = static_cast<quint8>(component);
+
+    // Aggregates only stand in for hours whose raw samples have been overwritten
+    const quint32 rawStart = m_header->rawCount ? raw(oldestRaw()).timestamp : std::numeric_limits<quint32>::max();
+
+    // Clock changes leave both rings unsorted in places, so scan them rather than search
+    for (quint64 i = oldestHourly(); i < m_header->hourlyCount; ++i)
+    {
+        const HourlyRecord &aggregate = hourly(i);
+        if (aggregate.component == wanted && aggregate.hourStart + 3600 > from && aggregate.hourStart <= to
+            && aggregate.hourStart + 3600 <= rawStart)
+        {
+            points.append(QPointF((aggregate.hourStart + 1800) * 1000.0, aggregate.meanLevel));
+        }
+    }
+    for (quint64 i = oldestRaw(); i < m_header->rawCount; ++i)
+    {
+        const RawRecord &sample = raw(i);
+        if (sample.component == wanted && sample.timestamp >= from && sample.timestamp <= to)
+        {
+            points.append(QPointF(sample.timestamp * 1000.0, sample.level));
+        }
+    }
+    std::stable_sort(points.begin(), points.end(),
+                     [](const QPointF &a, const QPointF &b) { return a.x() < b.x(); });
+
+    return downsampleLttb(points, maxPoints);
+}
+
+QVariantList BatteryHistory::query(int component, qint64 fromMs, qint64 toMs, int maxPoints) const
+{
+    QVariantList list;
+    const QVector<QPointF> points = series(static_cast<Battery::Component>(component), fromMs, toMs, maxPoints);
+    list.reserve(points.size());
+    for (const QPointF &point : points)
+    {
+        list.append(point);
+    }
+    return list;
+}
+
+QVariantList BatteryHistory::recent(int component, int hours, int maxPoints) const
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    return query(component, now - qint64(hours) * 3600 * 1000, now, maxPoints);
+}
+
+quint64 BatteryHistory::oldestRaw() const
+{
+    return m_header->rawCount > RAW_CAPACITY ? m_header->rawCount - RAW_CAPACITY : 0;
+}
+
+quint64 BatteryHistory::oldestHourly() const
+{
+    return m_header->hourlyCount > HOURLY_CAPACITY ? m_header->hourlyCount - HOURLY_CAPACITY : 0;
+}
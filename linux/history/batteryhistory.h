@@ -0,0 +1,129 @@
+#pragma once
+
+#include <QFile>
+#include <QObject>
+#include <QPointF>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariantList>
+#include <QVector>
+#include "battery.hpp"
+
+/**
+ * @brief Largest-Triangle-Three-Buckets downsampling.
+ *
+ * Keeps the first and last point and, per bucket, the point spanning the
+ * largest triangle with its neighbours, so peaks and drops survive. Points
+ * must be sorted by x.
+ */
+QVector<QPointF> downsampleLttb(const QVector<QPointF> &points, int threshold);
+
+/**
+ * @brief Battery levels over time, kept in a memory-mapped file of fixed size.
+ *
+ * Every level change is appended to a ring of raw samples. Once an hour the
+ * finished hours are compacted into min/max/mean aggregates in a second ring,
+ * which keeps a year of history after the raw samples have been overwritten.
+ * Appending is a copy into the mapping, with no system call and no flush.
+ * Samples keep the wall-clock time they were recorded at, so the rings are
+ * not sorted across clock changes.
+ */
+class BatteryHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint32 MAGIC = 0x4C504248; // "LPBH"
+    static constexpr quint16 VERSION = 1;
+    static constexpr quint32 RAW_CAPACITY = 16384;           // Weeks of level changes
+    static constexpr quint32 HOURLY_CAPACITY = 4 * 24 * 366; // A year for every component
+    static constexpr int COMPACT_INTERVAL_MS = 60 * 60 * 1000;
+
+    struct RawRecord
+    {
+        quint32 timestamp; // Seconds since the epoch
+        quint8 component;  // Battery::Component
+        quint8 level;
+        quint8 charging;
+        quint8 reserved;
+    };
+
+    struct HourlyRecord
+    {
+        quint32 hourStart; // Seconds since the epoch, a multiple of 3600
+        quint8 component;
+        quint8 minLevel;
+        quint8 maxLevel;
+        quint8 meanLevel;
+        quint16 samples;
+        quint16 chargingSamples;
+        quint32 reserved;
+    };
+
+    explicit BatteryHistory(QObject *parent = nullptr);
+    ~BatteryHistory() override;
+
+    // Maps the file, creating it or starting over if it is not a history file
+    bool open(const QString &path);
+    bool isOpen() const { return m_header != nullptr; }
+    void close();
+
+    void record(Battery::Component component, quint8 level, bool charging, qint64 timestampMs);
+
+    // Folds the raw samples of every finished hour before nowMs into aggregates, on a pool thread
+    void compact(qint64 nowMs);
+
+    // Levels of a component between two times, at most maxPoints of them
+    QVector<QPointF> series(Battery::Component component, qint64 fromMs, qint64 toMs, int maxPoints) const;
+
+    // For QML charts: points with x in ms since the epoch and y in percent
+    Q_INVOKABLE QVariantList query(int component, qint64 fromMs, qint64 toMs, int maxPoints) const;
+    Q_INVOKABLE QVariantList recent(int component, int hours, int maxPoints) const;
+
+signals:
+    void recorded();
+
+private:
+    struct Header
+    {
+        quint32 magic;
+        quint16 version;
+        quint16 reserved;
+        quint32 rawCapacity;
+        quint32 hourlyCapacity;
+        quint64 rawCount;       // Samples ever appended, the next slot is rawCount % RAW_CAPACITY
+        quint64 hourlyCount;    // Aggregates ever appended
+        quint64 compactedCount; // Raw samples before this index are already aggregated
+        quint8 padding[24];
+    };
+    static_assert(sizeof(Header) == 64 && sizeof(RawRecord) == 8 && sizeof(HourlyRecord) == 16,
+                  "On-disk layout");
+
+    static constexpr qint64 FILE_SIZE = sizeof(Header) + qint64(RAW_CAPACITY) * sizeof(RawRecord)
+                                        + qint64(HOURLY_CAPACITY) * sizeof(HourlyRecord);
+
+    struct Compaction
+    {
+        QVector<HourlyRecord> aggregates; // Sorted by hour
+        quint64 compactedCount = 0;
+    };
+
+    const RawRecord &raw(quint64 index) const { return m_raw[index % RAW_CAPACITY]; }
+    const HourlyRecord &hourly(quint64 index) const { return m_hourly[index % HOURLY_CAPACITY]; }
+    quint64 oldestRaw() const;
+    quint64 oldestHourly() const;
+
+    // Runs on the pool, only sees its own copy of the samples
+    static Compaction aggregate(const QVector<RawRecord> &samples, quint64 firstIndex, qint64 nowMs);
+    void applyCompaction(const Compaction &compaction, quint64 generation);
+
+    QFile m_file;
+    uchar *m_map = nullptr;
+    Header *m_header = nullptr;
+    RawRecord *m_raw = nullptr;
+    HourlyRecord *m_hourly = nullptr;
+    QTimer m_compactTimer;
+    QThreadPool m_compactPool;
+    bool m_compacting = false;
+    quint64 m_generation = 0; // Bumped by close(), drops compactions of a previous mapping
+};
@@ -12,6 +12,9 @@
 #include <QTimer>
 #include <QProcess>
 #include <QRegularExpression>
+#include <QStandardPaths>
+#include <QDir>
+#include <QDateTime>
 
 #include "airpods_packets.h"
 #include "logger.h"
@@ -21,11 +24,17 @@
 #include "battery.hpp"
 #include "BluetoothMonitor.h"
 #include "autostartmanager.hpp"
+#include "devicecatalog.h"
 #include "deviceinfo.hpp"
 #include "ble/blemanager.h"
 #include "ble/bleutils.h"
+#include "ble/knowndevices.h"
+#include "ble/nearbydevices.h"
+#include "ble/scanscheduler.h"
 #include "QRCodeImageProvider.hpp"
 #include "systemsleepmonitor.hpp"
+#include "headtracking/headtrackingmanager.h"
+#include "history/batteryhistory.h"
 
 using namespace AirpodsTrayApp::Enums;
 
@@ -41,15 +50,24 @@ class AirPodsTrayApp : public QObject {
     Q_PROPERTY(int retryAttempts READ retryAttempts WRITE setRetryAttempts NOTIFY retryAttemptsChanged)
     Q_PROPERTY(bool hideOnStart READ hideOnStart CONSTANT)
     Q_PROPERTY(DeviceInfo *deviceInfo READ deviceInfo CONSTANT)
+    Q_PROPERTY(KnownDevices *knownDevices READ knownDevices CONSTANT)
+    Q_PROPERTY(NearbyDevicesModel *nearbyDevices READ nearbyDevices CONSTANT)
+    Q_PROPERTY(ScanScheduler *scanScheduler READ scanScheduler CONSTANT)
     Q_PROPERTY(QString phoneMacStatus READ phoneMacStatus NOTIFY phoneMacStatusChanged)
     Q_PROPERTY(bool hearingAidEnabled READ hearingAidEnabled WRITE setHearingAidEnabled NOTIFY hearingAidEnabledChanged)
+    Q_PROPERTY(HeadTrackingManager *headTracking READ headTracking CONSTANT)
+    Q_PROPERTY(BatteryHistory *batteryHistory READ batteryHistory CONSTANT)
 
 public:
     AirPodsTrayApp(bool debugMode, bool hideOnStart, QQmlApplicationEngine *parent = nullptr)
         : QObject(parent), debugMode(debugMode), m_settings(new QSettings("AirPodsTrayApp", "AirPodsTrayApp"))
         , m_autoStartManager(new AutoStartManager(this)), m_hideOnStart(hideOnStart), parent(parent)
-        , m_deviceInfo(new DeviceInfo(this)), m_bleManager(new BleManager(this))
+        , m_deviceInfo(new DeviceInfo(this)), m_knownDevices(new KnownDevices(m_deviceInfo, this)), m_bleManager(new BleManager(this))
+        , m_nearbyDevices(new NearbyDevicesModel(this)), m_scanScheduler(new ScanScheduler(m_bleManager, this))
         , m_systemSleepMonitor(new SystemSleepMonitor(this))
+        , m_headTracking(new HeadTrackingManager([this](const QByteArray &packet, const QString &logMessage)
+                                                 { return writePacketToSocket(packet, logMessage); }, this))
+        , m_batteryHistory(new BatteryHistory(this))
     {
         QLoggingCategory::setFilterRules(QString("librepods.debug=%1").arg(debugMode ? "true" : "false"));
         LOG_INFO("Initializing LibrePods");
@@ -62,23 +80,29 @@ public:
         connect(trayManager, &TrayIconManager::openSettings, this, &AirPodsTrayApp::onOpenSettings);
         connect(trayManager, &TrayIconManager::noiseControlChanged, this, &AirPodsTrayApp::setNoiseControlMode);
         connect(trayManager, &TrayIconManager::conversationalAwarenessToggled, this, &AirPodsTrayApp::setConversationalAwareness);
-        connect(m_deviceInfo, &DeviceInfo::batteryStatusChanged, trayManager, &TrayIconManager::updateBatteryStatus);
-        connect(m_deviceInfo, &DeviceInfo::noiseControlModeChanged, trayManager, &TrayIconManager::updateNoiseControlState);
-        connect(m_deviceInfo, &DeviceInfo::conversationalAwarenessChanged, trayManager, &TrayIconManager::updateConversationalAwareness);
+        connect(m_deviceInfo, &DeviceInfo::propertiesChanged, this, &AirPodsTrayApp::updateTray);
         connect(trayManager, &TrayIconManager::notificationsEnabledChanged, this, &AirPodsTrayApp::saveNotificationsEnabled);
         connect(trayManager, &TrayIconManager::notificationsEnabledChanged, this, &AirPodsTrayApp::notificationsEnabledChanged);
 
         // Initialize MediaController and connect signals
         mediaController = new MediaController(this);
         connect(mediaController, &MediaController::mediaStateChanged, this, &AirPodsTrayApp::handleMediaStateChange);
+        connect(mediaController, &MediaController::mediaStateChanged, m_deviceInfo, [this](MediaController::MediaState state)
+                { m_deviceInfo->setMediaPlaying(state == MediaController::MediaState::Playing); });
         mediaController->followMediaChanges();
 
         monitor = new BluetoothMonitor(this);
         connect(monitor, &BluetoothMonitor::deviceConnected, this, &AirPodsTrayApp::bluezDeviceConnected);
         connect(monitor, &BluetoothMonitor::deviceDisconnected, this, &AirPodsTrayApp::bluezDeviceDisconnected);
 
-        connect(m_bleManager, &BleManager::deviceFound, this, &AirPodsTrayApp::bleDeviceFound);
+        connect(m_bleManager, &BleManager::advertsFound, m_knownDevices, &KnownDevices::handleAdverts);
+        connect(m_bleManager, &BleManager::advertsFound, m_nearbyDevices, &NearbyDevicesModel::handleAdverts);
+        connect(m_knownDevices, &KnownDevices::deviceSeen, m_scanScheduler, &ScanScheduler::noteMatchingAdvert);
+        connect(monitor, &BluetoothMonitor::deviceDisconnected, m_scanScheduler, &ScanScheduler::kick);
+        connect(m_deviceInfo, &DeviceInfo::modelChanged, m_headTracking, [this]()
+                { m_headTracking->setSupported(m_deviceInfo->supports(DeviceCatalog::HeadTracking)); });
         connect(m_deviceInfo->getBattery(), &Battery::primaryChanged, this, &AirPodsTrayApp::primaryChanged);
+        connect(m_deviceInfo->getBattery(), &Battery::batteryStatusChanged, this, &AirPodsTrayApp::recordBatteryHistory);
         connect(m_systemSleepMonitor, &SystemSleepMonitor::systemGoingToSleep, this, &AirPodsTrayApp::onSystemGoingToSleep);
         connect(m_systemSleepMonitor, &SystemSleepMonitor::systemWakingUp, this, &AirPodsTrayApp::onSystemWakingUp);
 
@@ -87,6 +111,11 @@ public:
         setEarDetectionBehavior(loadEarDetectionSettings());
         setRetryAttempts(loadRetryAttempts());
 
+        const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QDir().mkpath(dataDir);
+        m_batteryHistory->open(dataDir + "/battery-history.bin");
+
+        m_scanScheduler->start();
         monitor->checkAlreadyConnectedDevices();
         LOG_INFO("AirPodsTrayApp initialized");
 
@@ -101,8 +130,7 @@ public:
                 // On startup after reboot, activate A2DP profile for already connected AirPods
                 QTimer::singleShot(2000, this, [this, address]()
                 {
-                    QString formattedAddress = address.toString().replace(":", "_");
-                    mediaController->setConnectedDeviceMacAddress(formattedAddress);
+                    mediaController->setConnectedDeviceAddress(BluetoothAddress(address.toUInt64()));
                     mediaController->activateA2dpProfile();
                     LOG_INFO("A2DP profile activation attempted for AirPods found on startup");
                 });
@@ -131,8 +159,13 @@ public:
     int retryAttempts() const { return m_retryAttempts; }
     bool hideOnStart() const { return m_hideOnStart; }
     DeviceInfo *deviceInfo() const { return m_deviceInfo; }
+    KnownDevices *knownDevices() const { return m_knownDevices; }
+    NearbyDevicesModel *nearbyDevices() const { return m_nearbyDevices; }
+    ScanScheduler *scanScheduler() const { return m_scanScheduler; }
     QString phoneMacStatus() const { return m_phoneMacStatus; }
     bool hearingAidEnabled() const { return m_deviceInfo->hearingAidEnabled(); }
+    HeadTrackingManager *headTracking() const { return m_headTracking; }
+    BatteryHistory *batteryHistory() const { return m_batteryHistory; }
 
 private:
     bool debugMode;
@@ -188,6 +221,14 @@ public slots:
             LOG_INFO("Noise control mode is already set to: " << static_cast<int>(mode));
             return;
         }
+        if ((mode == NoiseControlMode::Adaptive && !isSupported(DeviceCatalog::AdaptiveMode, "Adaptive mode"))
+            || ((mode == NoiseControlMode::NoiseCancellation || mode == NoiseControlMode::Transparency)
+                && !isSupported(DeviceCatalog::NoiseCancellation, "Noise cancellation")))
+        {
+            // The tray already checked the rejected mode, show the one the device has
+            trayManager->updateNoiseControlState(m_deviceInfo->noiseControlMode());
+            return;
+        }
         LOG_INFO("Setting noise control mode to: " << mode);
         QByteArray packet = AirPodsPackets::NoiseControl::getPacketForMode(mode);
         writePacketToSocket(packet, "Noise control mode packet written: ");
@@ -204,6 +245,11 @@ public slots:
 
     void setConversationalAwareness(bool enabled)
     {
+        if (!isSupported(DeviceCatalog::ConversationalAwareness, "Conversational awareness"))
+        {
+            trayManager->updateConversationalAwareness(m_deviceInfo->conversationalAwareness());
+            return;
+        }
         LOG_INFO("Setting conversational awareness to: " << (enabled ? "enabled" : "disabled"));
         QByteArray packet = enabled ? AirPodsPackets::ConversationalAwareness::ENABLED
                                     : AirPodsPackets::ConversationalAwareness::DISABLED;
@@ -219,6 +265,10 @@ public slots:
             LOG_INFO("One Bud ANC mode is already " << (enabled ? "enabled" : "disabled"));
             return;
         }
+        if (!isSupported(DeviceCatalog::OneBudANC, "One Bud ANC mode"))
+        {
+            return;
+        }
 
         LOG_INFO("Setting One Bud ANC mode to: " << (enabled ? "enabled" : "disabled"));
         QByteArray packet = enabled ? AirPodsPackets::OneBudANCMode::ENABLED
@@ -259,7 +309,8 @@ public slots:
     void setAdaptiveNoiseLevel(int level)
     {
         level = qBound(0, level, 100);
-        if (m_deviceInfo->adaptiveNoiseLevel() != level && m_deviceInfo->adaptiveModeActive())
+        if (m_deviceInfo->adaptiveNoiseLevel() != level && m_deviceInfo->adaptiveModeActive()
+            && isSupported(DeviceCatalog::AdaptiveMode, "Adaptive noise level"))
         {
             QByteArray packet = AirPodsPackets::AdaptiveNoise::getPacket(level);
             writePacketToSocket(packet, "Adaptive noise level packet written: ");
@@ -371,6 +422,10 @@ public slots:
 
     void setHearingAidEnabled(bool enabled)
     {
+        if (!isSupported(DeviceCatalog::HearingAid, "Hearing aid"))
+        {
+            return;
+        }
         LOG_INFO("Setting hearing aid to: " << (enabled ? "enabled" : "disabled"));
         QByteArray packet = enabled ? AirPodsPackets::HearingAid::ENABLED
                                     : AirPodsPackets::HearingAid::DISABLED;
@@ -379,6 +434,17 @@ public slots:
         m_deviceInfo->setHearingAidEnabled(enabled);
     }
 
+    // Commands the connected model does not understand are not sent at all
+    bool isSupported(DeviceCatalog::Feature feature, const char *name) const
+    {
+        if (DeviceCatalog::entry(m_deviceInfo->model()).supports(feature))
+        {
+            return true;
+        }
+        LOG_WARN(name << " is not supported by " << m_deviceInfo->model());
+        return false;
+    }
+
     bool writePacketToSocket(const QByteArray &packet, const QString &logMessage)
     {
         if (socket && socket->isOpen())
@@ -411,19 +477,20 @@ public slots:
         if (m_bleManager->isScanning())
         {
             LOG_INFO("Stopping BLE scan before going to sleep");
-            m_bleManager->stopScan();
+            logBleStats();
         }
+        m_scanScheduler->setSystemAwake(false);
     }
     void onSystemWakingUp()
     {
-        LOG_INFO("System is waking up, starting ble scan");
-        m_bleManager->startScan();
+        LOG_INFO("System is waking up, scanning for AirPods");
+        m_scanScheduler->setSystemAwake(true);
 
         // Check if AirPods are already connected and activate A2DP profile
-        if (areAirpodsConnected() && m_deviceInfo && !m_deviceInfo->bluetoothAddress().isEmpty())
+        if (areAirpodsConnected() && m_deviceInfo && !m_deviceInfo->bluetoothAddress().isNull())
         {
             LOG_INFO("AirPods already connected after wake-up, re-activating A2DP profile");
-            mediaController->setConnectedDeviceMacAddress(m_deviceInfo->bluetoothAddress().replace(":", "_"));
+            mediaController->setConnectedDeviceAddress(m_deviceInfo->bluetoothAddress());
 
             // Always activate A2DP profile after system wake since the profile might have been lost
             QTimer::singleShot(1000, this, [this]()
@@ -433,7 +500,7 @@ public slots:
             });
         }
 
-        // Also check for already connected devices via BlueZ
+        // Also check for already connected devices via BlueZ; setSystemAwake() above resumed scanning
         monitor->checkAlreadyConnectedDevices();
     }
 
@@ -479,20 +546,18 @@ private slots:
         writePacketToSocket(AirPodsPackets::Connection::HANDSHAKE, "Handshake packet written: ");
     }
 
-    void bluezDeviceConnected(const QString &address, const QString &name)
+    void bluezDeviceConnected(BluetoothAddress address, const QString &name)
     {
-        QBluetoothDeviceInfo device(QBluetoothAddress(address), name, 0);
+        QBluetoothDeviceInfo device(QBluetoothAddress(address.toUInt64()), name, 0);
         connectToDevice(device);
 
         // After system reboot, AirPods might be connected but A2DP profile not active
         // Attempt to activate A2DP profile after a delay to ensure connection is established
         QTimer::singleShot(2000, this, [this, address]()
         {
-            if (!address.isEmpty())
+            if (!address.isNull())
             {
-                QString formattedAddress = address;
-                formattedAddress = formattedAddress.replace(":", "_");
-                mediaController->setConnectedDeviceMacAddress(formattedAddress);
+                mediaController->setConnectedDeviceAddress(address);
                 mediaController->activateA2dpProfile();
                 LOG_INFO("A2DP profile activation attempted for newly connected device");
             }
@@ -514,9 +579,11 @@ private slots:
             LOG_DEBUG("AIRPODS_DISCONNECTED packet written: " << AirPodsPackets::Connection::AIRPODS_DISCONNECTED.toHex());
         }
 
+        m_headTracking->setLinkAvailable(false);
+
         // Clear the device name and model
         m_deviceInfo->reset();
-        m_bleManager->startScan();
+        m_scanScheduler->setLinkActive(false);
         emit airPodsStatusChanged();
 
         // Show system notification
@@ -526,11 +593,11 @@ private slots:
         trayManager->resetTrayIcon();
     }
 
-    void bluezDeviceDisconnected(const QString &address, const QString &name)
+    void bluezDeviceDisconnected(BluetoothAddress address, const QString &name)
     {
         if (address == m_deviceInfo->bluetoothAddress())
         {
-            onDeviceDisconnected(QBluetoothAddress(address));
+            onDeviceDisconnected(QBluetoothAddress(address.toUInt64()));
         } else {
             LOG_WARN("Disconnected device does not match connected device: " << address << " != " << m_deviceInfo->bluetoothAddress());
         }
@@ -578,7 +645,7 @@ private slots:
         m_deviceInfo->setModelNumber(extractString());
         m_deviceInfo->setManufacturer(extractString());
 
-        m_deviceInfo->setModel(parseModelNumber(m_deviceInfo->modelNumber()));
+        m_deviceInfo->setModel(DeviceCatalog::fromModelNumber(m_deviceInfo->modelNumber()));
         emit modelChanged();
 
         // Log extracted metadata
@@ -651,12 +718,18 @@ private slots:
                 this, handleError);
 
         localSocket->connectToService(device.address(), QBluetoothUuid("74ec2172-0bad-4d01-8f77-997b2be0722a"));
-        m_deviceInfo->setBluetoothAddress(device.address().toString());
+        m_deviceInfo->setBluetoothAddress(BluetoothAddress(device.address().toUInt64()));
         notifyAndroidDevice();
     }
 
     void parseData(const QByteArray &data)
     {
+        // Sensor packets arrive at a high rate while head tracking is active
+        if (m_headTracking->handlePacket(data))
+        {
+            return;
+        }
+
         LOG_DEBUG("Received: " << data.toHex());
 
         if (data.startsWith(AirPodsPackets::Parse::HANDSHAKE_ACK))
@@ -666,6 +739,7 @@ private slots:
         else if (data.startsWith(AirPodsPackets::Parse::FEATURES_ACK))
         {
             writePacketToSocket(AirPodsPackets::Connection::REQUEST_NOTIFICATIONS, "Request notifications packet written: ");
+            m_headTracking->setLinkAvailable(true);
 
             QTimer::singleShot(2000, this, [this]() {
                 if (m_deviceInfo->batteryStatus().isEmpty()) {
@@ -685,6 +759,8 @@ private slots:
             m_deviceInfo->setMagicAccIRK(keys.magicAccIRK);
             m_deviceInfo->setMagicAccEncKey(keys.magicAccEncKey);
             m_deviceInfo->saveToSettings(*m_settings);
+            m_knownDevices->rememberCurrentDevice();
+            m_knownDevices->save(*m_settings);
         }
         // Get CA state
         else if (data.startsWith(AirPodsPackets::ConversationalAwareness::HEADER)) {
@@ -721,8 +797,8 @@ private slots:
         else if ((data.size() == 22 || data.size() == 12) && data.startsWith(AirPodsPackets::Parse::BATTERY_STATUS))
         {
             m_deviceInfo->getBattery()->parsePacket(data);
-            m_deviceInfo->updateBatteryStatus();
-            LOG_INFO("Battery status: " << m_deviceInfo->batteryStatus());
+            LOG_INFO("Battery status: " << m_deviceInfo->batteryStatusText());
+            m_scanScheduler->setLinkActive(true); // Battery arrives over AAP, adverts are redundant
         }
         // Conversational Awareness Data
         else if (data.size() == 10 && data.startsWith(AirPodsPackets::ConversationalAwareness::DATA_HEADER))
@@ -734,12 +810,13 @@ private slots:
         {
             parseMetadata(data);
             initiateMagicPairing();
-            mediaController->setConnectedDeviceMacAddress(m_deviceInfo->bluetoothAddress().replace(":", "_"));
+            mediaController->setConnectedDeviceAddress(m_deviceInfo->bluetoothAddress());
             if (m_deviceInfo->getEarDetection()->oneOrMorePodsInEar()) // AirPods get added as output device only after this
             {
                 mediaController->activateA2dpProfile();
             }
-            m_bleManager->stopScan();
+            m_scanScheduler->setLinkActive(true);
+            logBleStats();
             emit airPodsStatusChanged();
         }
         else if (data.startsWith(AirPodsPackets::OneBudANCMode::HEADER)) {
@@ -845,7 +922,7 @@ private slots:
                 socket->close();
                 LOG_INFO("Disconnected from AirPods");
                 QProcess process;
-                process.start("bluetoothctl", QStringList() << "disconnect" << m_deviceInfo->bluetoothAddress());
+                process.start("bluetoothctl", QStringList() << "disconnect" << m_deviceInfo->bluetoothAddressString());
                 process.waitForFinished();
                 QString output = process.readAllStandardOutput().trimmed();
                 LOG_INFO("Bluetoothctl output: " << output);
@@ -870,16 +947,91 @@ private slots:
         QMetaObject::invokeMethod(this, "handlePhonePacket", Qt::QueuedConnection, Q_ARG(QByteArray, data));
     }
 
-    void bleDeviceFound(const BleInfo &device)
+    void logBleStats()
+    {
+        const RpaCache::Stats &stats = m_knownDevices->resolverStats();
+        LOG_DEBUG("RPA cache (" << m_knownDevices->count() << " known devices): " << stats.hits << " hits, " << stats.misses << " misses ("
+                  << qRound(stats.hitRate() * 100) << "% hit rate), " << stats.expired << " expired, "
+                  << stats.evictions << " evicted");
+        const EncKeyContext::Stats &payloadStats = m_deviceInfo->encKeyContext().stats();
+        LOG_DEBUG("Payload decryption: " << payloadStats.hits << " memoized, " << payloadStats.misses << " decrypted");
+        const BleManager::AdvertStats &adverts = m_bleManager->advertStats();
+        // Suppressed adverts come from every Apple advertiser nearby, not only the AirPods bound to QML;
+        // only the notifications the current device skipped are rebinds that were actually avoided
+        quint64 rebindsAvoided = m_deviceInfo->getBattery()->skippedNotifications()
+                                 + m_deviceInfo->getEarDetection()->skippedNotifications();
+        LOG_DEBUG("Adverts: " << adverts.received << " received, " << adverts.suppressed << " unchanged suppressed, "
+                  << adverts.heartbeats << " heartbeats, " << adverts.emitted << " emitted in "
+                  << m_bleManager->batchesDelivered() << " batches, " << adverts.dropped << " dropped; "
+                  << rebindsAvoided << " QML rebinds avoided for the current AirPods");
+        const ChangeNotifier::Stats &notifications = m_deviceInfo->notificationStats();
+        LOG_DEBUG("Device properties: " << notifications.changes << " changes folded into "
+                  << notifications.flushes << " UI updates");
+    }
+
+    // Appends the components changed by the last battery packet
+    void recordBatteryHistory()
     {
-        if (BLEUtils::isValidIrkRpa(m_deviceInfo->magicAccIRK(), device.address)) {
-            m_deviceInfo->setModel(device.modelName);
-            auto decryptet = BLEUtils::decryptLastBytes(device.encryptedPayload, m_deviceInfo->magicAccEncKey());
-            m_deviceInfo->getBattery()->parseEncryptedPacket(decryptet, device.primaryLeft, device.isThisPodInTheCase, isModelHeadset(m_deviceInfo->model()));
-            m_deviceInfo->getEarDetection()->overrideEarDetectionStatus(device.isPrimaryInEar, device.isSecondaryInEar);
+        const Battery *battery = m_deviceInfo->getBattery();
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (Battery::Component component : {Battery::Component::Left, Battery::Component::Right,
+                                             Battery::Component::Case, Battery::Component::Headset})
+        {
+            const Battery::BatteryState state = battery->getState(component);
+            if ((battery->lastChangeMask() & static_cast<Battery::ChangeMask>(component))
+                && state.status != Battery::BatteryStatus::Disconnected)
+            {
+                m_batteryHistory->record(component, state.level, state.status == Battery::BatteryStatus::Charging, now);
+            }
         }
     }
 
+    // The tray shows the emptier pod, or the headset
+    void updateTrayBatteryLevel()
+    {
+        const Battery *battery = m_deviceInfo->getBattery();
+        if (battery->getPrimaryPod() == Battery::Component::Headset)
+        {
+            trayManager->updateBatteryLevel(battery->getState(Battery::Component::Headset).level,
+                                            battery->isHeadsetCharging());
+            return;
+        }
+        int level = -1;
+        bool charging = false;
+        for (Battery::Component pod : {Battery::Component::Left, Battery::Component::Right})
+        {
+            const Battery::BatteryState state = battery->getState(pod);
+            if (state.status == Battery::BatteryStatus::Disconnected || state.level == 0)
+                continue;
+            if (level < 0 || state.level < level)
+            {
+                level = state.level;
+                charging = state.status == Battery::BatteryStatus::Charging;
+            }
+        }
+        trayManager->updateBatteryLevel(qMax(level, 0), charging);
+    }
+
+    // One tray refresh per DeviceInfo flush
+    void updateTray(quint32 properties)
+    {
+        if (properties & DeviceInfo::BatteryStatusProperty)
+        {
+            if (m_deviceInfo->batteryStatus().isEmpty())
+                trayManager->resetTrayIcon();
+            else
+                trayManager->updateBatteryStatus(m_deviceInfo->batteryStatus());
+        }
+        if ((properties & DeviceInfo::BatteryProperty) && !m_deviceInfo->batteryStatus().isEmpty())
+            updateTrayBatteryLevel();
+        if (properties & DeviceInfo::EstimatesProperty)
+            trayManager->updateBatteryEstimate(m_deviceInfo->batteryEstimate());
+        if (properties & DeviceInfo::NoiseControlModeProperty)
+            trayManager->updateNoiseControlState(m_deviceInfo->noiseControlMode());
+        if (properties & DeviceInfo::ConversationalAwarenessProperty)
+            trayManager->updateConversationalAwareness(m_deviceInfo->conversationalAwareness());
+    }
+
 public:
     void handleMediaStateChange(MediaController::MediaState state) {
         if (state == MediaController::MediaState::Playing) {
@@ -917,7 +1069,7 @@ public:
         if (force) {
             LOG_INFO("Forcing connection to AirPods");
             QProcess process;
-            process.start("bluetoothctl", QStringList() << "connect" << m_deviceInfo->bluetoothAddress());
+            process.start("bluetoothctl", QStringList() << "connect" << m_deviceInfo->bluetoothAddressString());
             process.waitForFinished();
             QString output = process.readAllStandardOutput().trimmed();
             LOG_INFO("Bluetoothctl output: " << output);
@@ -939,9 +1091,7 @@ public:
         connectToPhone();
 
         m_deviceInfo->loadFromSettings(*m_settings);
-        if (!areAirpodsConnected()) {
-            m_bleManager->startScan();
-        }
+        m_knownDevices->load(*m_settings);
     }
 
     void loadMainModule() {
@@ -979,8 +1129,13 @@ private:
     int m_retryAttempts = 3;
     bool m_hideOnStart = false;
     DeviceInfo *m_deviceInfo;
+    KnownDevices *m_knownDevices;
     BleManager *m_bleManager;
+    NearbyDevicesModel *m_nearbyDevices;
+    ScanScheduler *m_scanScheduler;
     SystemSleepMonitor *m_systemSleepMonitor = nullptr;
+    HeadTrackingManager *m_headTracking = nullptr;
+    BatteryHistory *m_batteryHistory = nullptr;
     QString m_phoneMacStatus;
 };
 
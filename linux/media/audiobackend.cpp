@@ -0,0 +1,166 @@
+#include "audiobackend.h"
+#include "logger.h"
+#include "pulseaudiocontroller.h"
+#ifdef HAVE_PIPEWIRE
+#include "pipewirecontroller.h"
+#endif
+
+#include <QMutexLocker>
+
+AudioBackend *AudioBackend::create(QObject *parent)
+{
+    const QString backend = qEnvironmentVariable("LIBREPODS_AUDIO_BACKEND");
+    if (backend == "pipewire")
+    {
+#ifdef HAVE_PIPEWIRE
+        return new PipeWireController(parent);
+#else
+        LOG_WARN("Built without PipeWire support, using PulseAudio");
+#endif
+    }
+    else if (!backend.isEmpty() && backend != "pulse")
+    {
+        LOG_WARN("Unknown audio backend " << backend << ", using PulseAudio");
+    }
+    return new PulseAudioController(parent);
+}
+
+bool AudioBackend::isReady() const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    return m_ready;
+}
+
+QString AudioBackend::getDefaultSink()
+{
+    QMutexLocker locker(&m_cacheMutex);
+    return m_defaultSink;
+}
+
+int AudioBackend::getSinkVolume(const QString &sinkName)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    for (const Sink &sink : std::as_const(m_sinks))
+    {
+        if (sink.name == sinkName)
+        {
+            return sink.volumePercent;
+        }
+    }
+    return -1;
+}
+
+QString AudioBackend::getCardNameForDevice(BluetoothAddress address)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    for (const CardSnapshot &card : std::as_const(m_cards))
+    {
+        if (bluezDeviceAddress(card.name) == address)
+        {
+            return card.name;
+        }
+    }
+    return QString();
+}
+
+CardSnapshot AudioBackend::getCardSnapshot(const QString &cardName)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    for (const CardSnapshot &card : std::as_const(m_cards))
+    {
+        if (card.name == cardName)
+        {
+            return card;
+        }
+    }
+    return CardSnapshot();
+}
+
+BluetoothAddress AudioBackend::bluezDeviceAddress(QStringView name)
+{
+    if (!name.startsWith(u"bluez"))
+    {
+        return BluetoothAddress();
+    }
+    qsizetype dot = name.indexOf(u'.');
+    if (dot < 0)
+    {
+        return BluetoothAddress();
+    }
+    return BluetoothAddress::fromString(name.mid(dot + 1, BluetoothAddress::STRING_LENGTH));
+}
+
+void AudioBackend::setReady(bool ready)
+{
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        m_ready = ready;
+        if (ready)
+        {
+            LOG_INFO(name() << " backend ready with " << m_sinks.size() << " sinks and " << m_cards.size()
+                     << " cards");
+        }
+    }
+    if (ready)
+    {
+        emit this->ready();
+    }
+}
+
+void AudioBackend::setDefaultSink(const QString &sinkName)
+{
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (m_defaultSink == sinkName)
+        {
+            return;
+        }
+        m_defaultSink = sinkName;
+    }
+    LOG_DEBUG("Default sink: " << sinkName);
+    emit defaultSinkChanged(sinkName);
+}
+
+void AudioBackend::updateSink(quint32 id, const Sink &sink)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_sinks.insert(id, sink);
+}
+
+void AudioBackend::removeSink(quint32 id)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_sinks.remove(id);
+}
+
+void AudioBackend::updateCard(quint32 id, const CardSnapshot &card)
+{
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        m_cards.insert(id, card);
+    }
+    emit cardChanged(card.name);
+}
+
+void AudioBackend::removeCard(quint32 id)
+{
+    QString name;
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        name = m_cards.take(id).name;
+    }
+    if (!name.isEmpty())
+    {
+        LOG_DEBUG("Audio card removed: " << name);
+        emit cardRemoved(name);
+    }
+}
+
+void AudioBackend::clearCache()
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_ready = false;
+    m_defaultSink.clear();
+    m_sinks.clear();
+    m_cards.clear();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include "bluetoothaddress.h"
+#include "cardsnapshot.h"
+
+/**
+ * @brief Sound server the media controller talks to, with its sinks and cards kept in memory.
+ *
+ * Backends fill the cache from their own event thread, so the getters answer
+ * without a round trip. Changes return a QFuture that finishes on the event
+ * thread; attach continuations with QFuture::then(context, ...) to run them
+ * on the caller's thread. No method waits for the server.
+ *
+ * create() picks the backend named by LIBREPODS_AUDIO_BACKEND ("pulse" or
+ * "pipewire"), PulseAudio by default.
+ */
+class AudioBackend : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_TIMEOUT_MS = 3000;
+
+    static AudioBackend *create(QObject *parent = nullptr);
+
+    using QObject::QObject;
+
+    // Starts connecting; the cache fills and ready() is emitted once the server answers
+    virtual bool initialize() = 0;
+    virtual const char *name() const = 0;
+    bool isReady() const;
+
+    QString getDefaultSink();
+    int getSinkVolume(const QString &sinkName);
+    QString getCardNameForDevice(BluetoothAddress address);
+    // Profiles of a card as last reported by the server, invalid if the card is unknown
+    CardSnapshot getCardSnapshot(const QString &cardName);
+
+    // Result is true once the server applied the change, false on failure or timeout.
+    // Cancelling the future drops the result; a request already sent is not undone.
+    virtual QFuture<bool> setSinkVolume(const QString &sinkName, int volumePercent,
+                                        int timeoutMs = DEFAULT_TIMEOUT_MS) = 0;
+    virtual QFuture<bool> setCardProfile(const QString &cardName, const QString &profileName,
+                                         int timeoutMs = DEFAULT_TIMEOUT_MS) = 0;
+
+    // Address in a BlueZ card or sink name such as bluez_card.AA_BB_CC_DD_EE_FF or bluez_output.AA_BB_CC_DD_EE_FF.1
+    static BluetoothAddress bluezDeviceAddress(QStringView name);
+
+signals:
+    // Emitted from the backend's event thread
+    void ready();
+    void defaultSinkChanged(const QString &sinkName);
+    void cardChanged(const QString &cardName);
+    void cardRemoved(const QString &cardName);
+
+protected:
+    struct Sink
+    {
+        QString name;
+        int volumePercent = -1;
+    };
+
+    // Cache updates for the backends, they emit the matching signals
+    void setReady(bool ready);
+    void setDefaultSink(const QString &sinkName);
+    void updateSink(quint32 id, const Sink &sink);
+    void removeSink(quint32 id);
+    void updateCard(quint32 id, const CardSnapshot &card);
+    void removeCard(quint32 id);
+    void clearCache();
+
+    mutable QMutex m_cacheMutex; // Guards the members below, written from the event thread
+    bool m_ready = false;
+    QString m_defaultSink;
+    QHash<quint32, Sink> m_sinks;         // Keyed by the server's sink or node id
+    QHash<quint32, CardSnapshot> m_cards; // Keyed by the server's card or device id
+};
@@ -0,0 +1,48 @@
+#include "cardsnapshot.h"
+
+const CardSnapshot::Profile *CardSnapshot::profile(const QString &profileName) const
+{
+    for (const Profile &candidate : profiles)
+    {
+        if (candidate.name == profileName)
+        {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+QString selectA2dpProfile(const CardSnapshot &card, const QString &preferred)
+{
+    auto usable = [&card](const QString &profileName) {
+        const CardSnapshot::Profile *profile = card.profile(profileName);
+        return profile && profile->available;
+    };
+
+    if (!preferred.isEmpty() && usable(preferred))
+    {
+        return preferred;
+    }
+
+    // SBC-XQ sounds better than plain SBC and works on every AirPods model
+    static const QString knownProfiles[] = {"a2dp-sink-sbc_xq", "a2dp-sink-sbc", "a2dp-sink"};
+    for (const QString &profileName : knownProfiles)
+    {
+        if (usable(profileName))
+        {
+            return profileName;
+        }
+    }
+
+    // Any other A2DP sink codec, highest server priority first
+    const CardSnapshot::Profile *best = nullptr;
+    for (const CardSnapshot::Profile &profile : card.profiles)
+    {
+        if (profile.available && profile.name.startsWith(QLatin1String("a2dp-sink"))
+            && (!best || profile.priority > best->priority))
+        {
+            best = &profile;
+        }
+    }
+    return best ? best->name : QString();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+
+/**
+ * @brief Everything needed to pick a profile for one audio card.
+ */
+struct CardSnapshot
+{
+    struct Profile
+    {
+        QString name;
+        quint32 priority = 0;
+        bool available = true; // False when the server knows it cannot be used right now
+    };
+
+    QString name;
+    QString activeProfile;
+    QList<Profile> profiles;
+
+    bool isValid() const { return !name.isEmpty(); }
+    const Profile *profile(const QString &profileName) const;
+};
+
+// Best usable A2DP sink profile, or an empty string if there is none.
+// The preferred profile wins while it is still usable, so a working choice is kept.
+QString selectA2dpProfile(const CardSnapshot &card, const QString &preferred = QString());
@@ -2,21 +2,40 @@
 #include "logger.h"
 #include "eardetection.hpp"
 #include "playerstatuswatcher.h"
-#include "pulseaudiocontroller.h"
+#include "audiobackend.h"
+#include "wireplumberrecovery.h"
 
 #include <QDebug>
-#include <QProcess>
-#include <QThread>
 #include <QRegularExpression>
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
 
 MediaController::MediaController(QObject *parent) : QObject(parent) {
-  m_pulseAudio = new PulseAudioController(this);
-  if (!m_pulseAudio->initialize())
+  m_audio = AudioBackend::create(this);
+  if (!m_audio->initialize())
   {
-    LOG_ERROR("Failed to initialize PulseAudio controller");
+    LOG_ERROR("Failed to initialize the audio backend");
   }
+
+  // The card of the AirPods comes and goes with the Bluetooth connection and WirePlumber restarts
+  connect(m_audio, &AudioBackend::cardChanged, this, [this](const QString &cardName) {
+    if (m_deviceOutputName.isEmpty() && !connectedDeviceAddress.isNull()
+        && AudioBackend::bluezDeviceAddress(cardName) == connectedDeviceAddress) {
+      m_deviceOutputName = cardName;
+      LOG_INFO("Device output name set to: " << m_deviceOutputName);
+    }
+  });
+  m_wirePlumberRecovery = new WirePlumberRecovery(m_audio, this);
+  connect(m_wirePlumberRecovery, &WirePlumberRecovery::recovered, this, [this](const QString &cardName, const QString &profile) {
+    m_deviceOutputName = cardName;
+    m_cachedA2dpProfile = profile;
+  });
+  connect(m_audio, &AudioBackend::cardRemoved, this, [this](const QString &cardName) {
+    if (cardName == m_deviceOutputName) {
+      m_deviceOutputName.clear();
+      m_cachedA2dpProfile.clear();
+    }
+  });
 }
 
 void MediaController::handleEarDetection(EarDetection *earDetection)
@@ -95,9 +114,9 @@ void MediaController::followMediaChanges() {
 }
 
 bool MediaController::isActiveOutputDeviceAirPods() {
-  QString defaultSink = m_pulseAudio->getDefaultSink();
+  QString defaultSink = m_audio->getDefaultSink();
   LOG_DEBUG("Default sink: " << defaultSink);
-  return defaultSink.contains(connectedDeviceMacAddress);
+  return !connectedDeviceAddress.isNull() && AudioBackend::bluezDeviceAddress(defaultSink) == connectedDeviceAddress;
 }
 
 void MediaController::handleConversationalAwareness(const QByteArray &data) {
@@ -105,31 +124,41 @@ void MediaController::handleConversationalAwareness(const QByteArray &data) {
   bool lowered = data[9] == 0x01;
   LOG_INFO("Conversational awareness: " << (lowered ? "enabled" : "disabled"));
 
+  // A newer change supersedes one still in flight
+  m_volumeChange.cancel();
+
   if (lowered) {
     if (initialVolume == -1 && isActiveOutputDeviceAirPods()) {
-      QString defaultSink = m_pulseAudio->getDefaultSink();
-      initialVolume = m_pulseAudio->getSinkVolume(defaultSink);
+      QString defaultSink = m_audio->getDefaultSink();
+      initialVolume = m_audio->getSinkVolume(defaultSink);
       if (initialVolume == -1) {
         LOG_ERROR("Failed to get initial volume");
         return;
       }
       LOG_DEBUG("Initial volume: " << initialVolume << "%");
     }
-    QString defaultSink = m_pulseAudio->getDefaultSink();
+    QString defaultSink = m_audio->getDefaultSink();
     int targetVolume = initialVolume * 0.20;
-    if (m_pulseAudio->setSinkVolume(defaultSink, targetVolume)) {
-      LOG_INFO("Volume lowered to 0.20 of initial which is " << targetVolume << "%");
-    } else {
-      LOG_ERROR("Failed to lower volume");
-    }
-  } else {
-    if (initialVolume != -1 && isActiveOutputDeviceAirPods()) {
-      QString defaultSink = m_pulseAudio->getDefaultSink();
-      if (m_pulseAudio->setSinkVolume(defaultSink, initialVolume)) {
-        LOG_INFO("Volume restored to " << initialVolume << "%");
+    m_volumeChange = m_audio->setSinkVolume(defaultSink, targetVolume);
+    m_volumeChange.then(this, [targetVolume](bool success) {
+      if (success) {
+        LOG_INFO("Volume lowered to 0.20 of initial which is " << targetVolume << "%");
       } else {
-        LOG_ERROR("Failed to restore volume");
+        LOG_ERROR("Failed to lower volume");
       }
+    });
+  } else {
+    if (initialVolume != -1 && isActiveOutputDeviceAirPods()) {
+      QString defaultSink = m_audio->getDefaultSink();
+      const int restoredVolume = initialVolume;
+      m_volumeChange = m_audio->setSinkVolume(defaultSink, restoredVolume);
+      m_volumeChange.then(this, [restoredVolume](bool success) {
+        if (success) {
+          LOG_INFO("Volume restored to " << restoredVolume << "%");
+        } else {
+          LOG_ERROR("Failed to restore volume");
+        }
+      });
       initialVolume = -1;
     }
   }
@@ -140,95 +169,85 @@ bool MediaController::isA2dpProfileAvailable() {
     return false;
   }
 
-  return m_pulseAudio->isProfileAvailable(m_deviceOutputName, "a2dp-sink-sbc_xq") || 
-         m_pulseAudio->isProfileAvailable(m_deviceOutputName, "a2dp-sink-sbc") ||
-         m_pulseAudio->isProfileAvailable(m_deviceOutputName, "a2dp-sink");
+  return !selectA2dpProfile(m_audio->getCardSnapshot(m_deviceOutputName)).isEmpty();
 }
 
 QString MediaController::getPreferredA2dpProfile() {
   if (m_deviceOutputName.isEmpty()) {
     return QString();
   }
-
-  if (!m_cachedA2dpProfile.isEmpty() && 
-      m_pulseAudio->isProfileAvailable(m_deviceOutputName, m_cachedA2dpProfile)) {
-    return m_cachedA2dpProfile;
-  }
-
-  QStringList profiles = {"a2dp-sink-sbc_xq", "a2dp-sink-sbc", "a2dp-sink"};
-
-  for (const QString &profile : profiles) {
-    if (m_pulseAudio->isProfileAvailable(m_deviceOutputName, profile)) {
-      LOG_INFO("Selected best available A2DP profile: " << profile);
-      m_cachedA2dpProfile = profile;
-      return profile;
-    }
-  }
-
-  m_cachedA2dpProfile.clear();
-  return QString();
+  return getPreferredA2dpProfile(m_audio->getCardSnapshot(m_deviceOutputName));
 }
 
-bool MediaController::restartWirePlumber() {
-  LOG_INFO("Restarting WirePlumber to rediscover A2DP profiles");
-  int result = QProcess::execute("systemctl", QStringList() << "--user" << "restart" << "wireplumber");
-  if (result == 0) {
-    LOG_INFO("WirePlumber restarted successfully");
-    QThread::sleep(2);
-    return true;
-  } else {
-    LOG_ERROR("Failed to restart WirePlumber. Do you use wireplumber?");
-    return false;
+QString MediaController::getPreferredA2dpProfile(const CardSnapshot &card) {
+  QString profile = selectA2dpProfile(card, m_cachedA2dpProfile);
+  if (!profile.isEmpty() && profile != m_cachedA2dpProfile) {
+    LOG_INFO("Selected best available A2DP profile: " << profile);
   }
+  m_cachedA2dpProfile = profile;
+  return profile;
 }
 
 void MediaController::activateA2dpProfile() {
-  if (connectedDeviceMacAddress.isEmpty() || m_deviceOutputName.isEmpty()) {
+  if (connectedDeviceAddress.isNull() || m_deviceOutputName.isEmpty()) {
     LOG_WARN("Connected device MAC address or output name is empty, cannot activate A2DP profile");
     return;
   }
 
-  if (!isA2dpProfileAvailable()) {
-    LOG_WARN("A2DP profile not available, attempting to restart WirePlumber");
-    if (restartWirePlumber()) {
-      m_deviceOutputName = getAudioDeviceName();
-      if (!isA2dpProfileAvailable()) {
-        LOG_ERROR("A2DP profile still not available after WirePlumber restart");
-        return;
-      }
-    } else {
-      LOG_ERROR("Could not restart WirePlumber, A2DP profile unavailable");
-      return;
-    }
+  if (m_wirePlumberRecovery->isRunning()) {
+    LOG_DEBUG("WirePlumber recovery in progress, it activates the A2DP profile when done");
+    return;
   }
 
-  QString preferredProfile = getPreferredA2dpProfile();
+  // One look at the card decides everything below
+  const CardSnapshot card = m_audio->getCardSnapshot(m_deviceOutputName);
+  const QString preferredProfile = getPreferredA2dpProfile(card);
   if (preferredProfile.isEmpty()) {
-    LOG_ERROR("No suitable A2DP profile found");
+    LOG_WARN("A2DP profile not available, attempting to restart WirePlumber");
+    m_profileChange.cancel();
+    m_wirePlumberRecovery->start(connectedDeviceAddress);
     return;
   }
 
-  LOG_INFO("Activating A2DP profile for AirPods: " << preferredProfile);
-  if (!m_pulseAudio->setCardProfile(m_deviceOutputName, preferredProfile)) {
-    LOG_ERROR("Failed to activate A2DP profile: " << preferredProfile);
+  // A change still in flight may move the card away from what the snapshot shows
+  if (card.activeProfile == preferredProfile && m_profileChange.isFinished()) {
+    LOG_DEBUG("A2DP profile already active: " << preferredProfile);
+    return;
   }
-  LOG_INFO("A2DP profile activated successfully");
+
+  LOG_INFO("Activating A2DP profile for AirPods: " << preferredProfile);
+  setCardProfile(preferredProfile);
+}
+
+void MediaController::setCardProfile(const QString &profile) {
+  // Ear detection can flip faster than the server answers, only the latest change reports back
+  m_profileChange.cancel();
+  m_profileChange = m_audio->setCardProfile(m_deviceOutputName, profile);
+  m_profileChange.then(this, [profile](bool success) {
+    if (success) {
+      LOG_INFO("Card profile set to: " << profile);
+    } else {
+      LOG_ERROR("Failed to set card profile: " << profile);
+    }
+  });
 }
 
 void MediaController::removeAudioOutputDevice() {
-  if (connectedDeviceMacAddress.isEmpty() || m_deviceOutputName.isEmpty()) {
+  if (connectedDeviceAddress.isNull() || m_deviceOutputName.isEmpty()) {
     LOG_WARN("Connected device MAC address or output name is empty, cannot remove audio output device");
     return;
   }
   
   LOG_INFO("Removing AirPods as audio output device");
-  if (!m_pulseAudio->setCardProfile(m_deviceOutputName, "off")) {
-    LOG_ERROR("Failed to remove AirPods as audio output device");
-  }
+  m_wirePlumberRecovery->cancel();
+  setCardProfile("off");
 }
 
-void MediaController::setConnectedDeviceMacAddress(const QString &macAddress) {
-  connectedDeviceMacAddress = macAddress;
+void MediaController::setConnectedDeviceAddress(BluetoothAddress address) {
+  if (address != connectedDeviceAddress) {
+    m_wirePlumberRecovery->cancel();
+  }
+  connectedDeviceAddress = address;
   m_deviceOutputName = getAudioDeviceName();
   m_cachedA2dpProfile.clear();
   LOG_INFO("Device output name set to: " << m_deviceOutputName);
@@ -395,11 +414,11 @@ MediaController::~MediaController() {
 
 QString MediaController::getAudioDeviceName()
 {
-  if (connectedDeviceMacAddress.isEmpty()) { return QString(); }
+  if (connectedDeviceAddress.isNull()) { return QString(); }
 
-  QString cardName = m_pulseAudio->getCardNameForDevice(connectedDeviceMacAddress);
+  QString cardName = m_audio->getCardNameForDevice(connectedDeviceAddress);
   if (cardName.isEmpty()) {
-    LOG_ERROR("No matching Bluetooth card found for MAC address: " << connectedDeviceMacAddress);
+    LOG_ERROR("No matching Bluetooth card found for MAC address: " << connectedDeviceAddress);
   }
   return cardName;
 }
\ No newline at end of file
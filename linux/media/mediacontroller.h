@@ -1,13 +1,15 @@
 #ifndef MEDIACONTROLLER_H
 #define MEDIACONTROLLER_H
 
+#include <QFuture>
 #include <QObject>
-#include "pulseaudiocontroller.h"
+#include "audiobackend.h"
 
 class QProcess;
 class EarDetection;
 class PlayerStatusWatcher;
 class QDBusInterface;
+class WirePlumberRecovery;
 
 class MediaController : public QObject
 {
@@ -37,10 +39,9 @@ public:
   void handleConversationalAwareness(const QByteArray &data);
   void activateA2dpProfile();
   void removeAudioOutputDevice();
-  void setConnectedDeviceMacAddress(const QString &macAddress);
+  void setConnectedDeviceAddress(BluetoothAddress address);
   bool isA2dpProfileAvailable();
   QString getPreferredA2dpProfile();
-  bool restartWirePlumber();
 
   void setEarDetectionBehavior(EarDetectionBehavior behavior);
   inline EarDetectionBehavior getEarDetectionBehavior() const { return earDetectionBehavior; }
@@ -56,15 +57,20 @@ private:
   MediaState mediaStateFromPlayerctlOutput(const QString &output) const;
   QString getAudioDeviceName();
   QStringList getPlayingMediaPlayers();
+  QString getPreferredA2dpProfile(const CardSnapshot &card);
+  void setCardProfile(const QString &profile);
 
   QStringList pausedByAppServices;
   int initialVolume = -1;
-  QString connectedDeviceMacAddress;
+  BluetoothAddress connectedDeviceAddress;
   EarDetectionBehavior earDetectionBehavior = PauseWhenOneRemoved;
   QString m_deviceOutputName;
   PlayerStatusWatcher *playerStatusWatcher = nullptr;
-  PulseAudioController *m_pulseAudio = nullptr;
+  AudioBackend *m_audio = nullptr;
+  WirePlumberRecovery *m_wirePlumberRecovery = nullptr;
   QString m_cachedA2dpProfile;
+  QFuture<bool> m_profileChange; // Latest card profile change, cancelled when superseded
+  QFuture<bool> m_volumeChange;
 };
 
 #endif // MEDIACONTROLLER_H
\ No newline at end of file
@@ -0,0 +1,608 @@
+#include "pipewirecontroller.h"
+#include "logger.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPromise>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <spa/param/audio/raw.h>
+#include <spa/param/profile.h>
+#include <spa/param/props.h>
+#include <spa/param/route.h>
+#include <spa/pod/builder.h>
+#include <spa/pod/iter.h>
+#include <spa/pod/parser.h>
+#include <spa/utils/result.h>
+#include <utility>
+
+struct PipeWireController::Device
+{
+    PipeWireController *controller;
+    uint32_t id;
+    pw_device *proxy;
+    QString name;
+    spa_hook listener{};
+    QMap<int, CardSnapshot::Profile> profiles; // Keyed by profile index
+    int activeProfile = -1;
+    bool dirty = false;
+
+    CardSnapshot snapshot() const
+    {
+        CardSnapshot card;
+        card.name = name;
+        card.activeProfile = profiles.value(activeProfile).name;
+        card.profiles = profiles.values();
+        return card;
+    }
+};
+
+struct PipeWireController::Node
+{
+    PipeWireController *controller;
+    uint32_t id;
+    pw_node *proxy;
+    QString name;
+    spa_hook listener{};
+    uint32_t channels = 2;
+};
+
+struct PipeWireController::PendingOperation
+{
+    PipeWireController *controller;
+    const char *description; // What failed, e.g. "set card profile"
+    QPromise<bool> promise;
+    uint32_t proxyId = SPA_ID_INVALID; // Errors for this proxy fail the operation
+    int seq = -1;                      // Core sync that ends the operation
+    spa_source *timeout = nullptr;
+    bool failed = false;
+};
+
+namespace
+{
+constexpr uint32_t DEVICE_PARAMS[] = {SPA_PARAM_EnumProfile, SPA_PARAM_Profile};
+constexpr uint32_t NODE_PARAMS[] = {SPA_PARAM_Props};
+
+// PipeWire volumes are linear, the percentages shown by pulse tools are cubic
+int volumeToPercent(float volume)
+{
+    return static_cast<int>(std::lround(std::cbrt(volume) * 100.0f));
+}
+
+float percentToVolume(int percent)
+{
+    const float cubic = percent / 100.0f;
+    return cubic * cubic * cubic;
+}
+} // namespace
+
+const pw_core_events PipeWireController::CORE_EVENTS = []() {
+    pw_core_events events{};
+    events.version = PW_VERSION_CORE_EVENTS;
+    events.done = [](void *data, uint32_t id, int seq) { static_cast<PipeWireController *>(data)->coreDone(id, seq); };
+    events.error = [](void *data, uint32_t id, int seq, int res, const char *message) {
+        static_cast<PipeWireController *>(data)->coreError(id, seq, res, message);
+    };
+    return events;
+}();
+
+const pw_registry_events PipeWireController::REGISTRY_EVENTS = []() {
+    pw_registry_events events{};
+    events.version = PW_VERSION_REGISTRY_EVENTS;
+    events.global = [](void *data, uint32_t id, uint32_t, const char *type, uint32_t, const spa_dict *props) {
+        static_cast<PipeWireController *>(data)->registryGlobal(id, type, props);
+    };
+    events.global_remove = [](void *data, uint32_t id) {
+        static_cast<PipeWireController *>(data)->registryGlobalRemove(id);
+    };
+    return events;
+}();
+
+const pw_device_events PipeWireController::DEVICE_EVENTS = []() {
+    pw_device_events events{};
+    events.version = PW_VERSION_DEVICE_EVENTS;
+    events.info = [](void *data, const pw_device_info *info) {
+        Device *device = static_cast<Device *>(data);
+        device->controller->deviceInfo(device, info);
+    };
+    events.param = [](void *data, int, uint32_t id, uint32_t, uint32_t, const spa_pod *param) {
+        Device *device = static_cast<Device *>(data);
+        device->controller->deviceParam(device, id, param);
+    };
+    return events;
+}();
+
+const pw_node_events PipeWireController::NODE_EVENTS = []() {
+    pw_node_events events{};
+    events.version = PW_VERSION_NODE_EVENTS;
+    events.param = [](void *data, int, uint32_t id, uint32_t, uint32_t, const spa_pod *param) {
+        Node *node = static_cast<Node *>(data);
+        node->controller->nodeParam(node, id, param);
+    };
+    return events;
+}();
+
+const pw_metadata_events PipeWireController::METADATA_EVENTS = []() {
+    pw_metadata_events events{};
+    events.version = PW_VERSION_METADATA_EVENTS;
+    events.property = [](void *data, uint32_t subject, const char *key, const char *, const char *value) {
+        return static_cast<PipeWireController *>(data)->metadataProperty(subject, key, value);
+    };
+    return events;
+}();
+
+PipeWireController::PipeWireController(QObject *parent) : AudioBackend(parent)
+{
+}
+
+PipeWireController::~PipeWireController()
+{
+    if (!m_loop)
+    {
+        return;
+    }
+    // Stop first so no callback runs while everything goes away
+    pw_thread_loop_stop(m_loop);
+    for (PendingOperation *pending : std::as_const(m_pending))
+    {
+        // Futures still waiting end up cancelled
+        if (pending->timeout)
+        {
+            pw_loop_destroy_source(pw_thread_loop_get_loop(m_loop), pending->timeout);
+        }
+        delete pending;
+    }
+    teardownCore();
+    if (m_reconnectTimer)
+    {
+        pw_loop_destroy_source(pw_thread_loop_get_loop(m_loop), m_reconnectTimer);
+    }
+    if (m_context)
+    {
+        pw_context_destroy(m_context);
+    }
+    pw_thread_loop_destroy(m_loop);
+    pw_deinit();
+}
+
+bool PipeWireController::initialize()
+{
+    pw_init(nullptr, nullptr);
+    m_loop = pw_thread_loop_new("librepods-pw", nullptr);
+    if (!m_loop)
+    {
+        LOG_ERROR("Failed to create PipeWire loop");
+        return false;
+    }
+    m_context = pw_context_new(pw_thread_loop_get_loop(m_loop), nullptr, 0);
+    if (!m_context)
+    {
+        LOG_ERROR("Failed to create PipeWire context");
+        return false;
+    }
+    if (pw_thread_loop_start(m_loop) < 0)
+    {
+        LOG_ERROR("Failed to start PipeWire loop");
+        return false;
+    }
+
+    pw_thread_loop_lock(m_loop);
+    m_reconnectTimer = pw_loop_add_timer(
+        pw_thread_loop_get_loop(m_loop),
+        [](void *data, uint64_t) {
+            PipeWireController *controller = static_cast<PipeWireController *>(data);
+            controller->teardownCore();
+            controller->connectCore();
+        },
+        this);
+    // A missing server is retried from the timer, like a lost connection
+    connectCore();
+    pw_thread_loop_unlock(m_loop);
+    return true;
+}
+
+bool PipeWireController::connectCore()
+{
+    m_core = pw_context_connect(m_context, nullptr, 0);
+    if (!m_core)
+    {
+        LOG_WARN("Cannot connect to PipeWire: " << std::strerror(errno) << ", retrying in " << RECONNECT_DELAY_MS
+                 << " ms");
+        armTimer(m_reconnectTimer, RECONNECT_DELAY_MS);
+        return false;
+    }
+    pw_core_add_listener(m_core, &m_coreListener, &CORE_EVENTS, this);
+    m_registry = pw_core_get_registry(m_core, PW_VERSION_REGISTRY, 0);
+    pw_registry_add_listener(m_registry, &m_registryListener, &REGISTRY_EVENTS, this);
+
+    // The first sync delivers the globals, the second the params of the objects bound on the way
+    m_readySyncs = 2;
+    requestSync();
+    return true;
+}
+
+void PipeWireController::teardownCore()
+{
+    for (auto &entry : m_devices)
+    {
+        spa_hook_remove(&entry.second->listener);
+        pw_proxy_destroy(reinterpret_cast<pw_proxy *>(entry.second->proxy));
+    }
+    m_devices.clear();
+    for (auto &entry : m_nodes)
+    {
+        spa_hook_remove(&entry.second->listener);
+        pw_proxy_destroy(reinterpret_cast<pw_proxy *>(entry.second->proxy));
+    }
+    m_nodes.clear();
+    if (m_metadata)
+    {
+        spa_hook_remove(&m_metadataListener);
+        pw_proxy_destroy(reinterpret_cast<pw_proxy *>(m_metadata));
+        m_metadata = nullptr;
+    }
+    if (m_registry)
+    {
+        spa_hook_remove(&m_registryListener);
+        pw_proxy_destroy(reinterpret_cast<pw_proxy *>(m_registry));
+        m_registry = nullptr;
+    }
+    if (m_core)
+    {
+        spa_hook_remove(&m_coreListener);
+        pw_core_disconnect(m_core);
+        m_core = nullptr;
+    }
+    m_syncSeq = -1;
+}
+
+void PipeWireController::armTimer(spa_source *timer, int ms)
+{
+    timespec value{ms / 1000, (ms % 1000) * 1000000L};
+    pw_loop_update_timer(pw_thread_loop_get_loop(m_loop), timer, &value, nullptr, false);
+}
+
+void PipeWireController::requestSync()
+{
+    if (m_syncSeq < 0 && m_core)
+    {
+        m_syncSeq = pw_core_sync(m_core, PW_ID_CORE, 0);
+    }
+}
+
+void PipeWireController::publishDevices()
+{
+    for (auto &entry : m_devices)
+    {
+        Device *device = entry.second.get();
+        if (device->dirty)
+        {
+            device->dirty = false;
+            updateCard(device->id, device->snapshot());
+        }
+    }
+}
+
+void PipeWireController::coreDone(uint32_t id, int seq)
+{
+    if (id != PW_ID_CORE)
+    {
+        return;
+    }
+
+    const QList<PendingOperation *> pending = m_pending.values();
+    for (PendingOperation *operation : pending)
+    {
+        if (operation->seq == seq)
+        {
+            finishOperation(operation, !operation->failed);
+        }
+    }
+
+    if (seq != m_syncSeq)
+    {
+        return;
+    }
+    m_syncSeq = -1;
+    publishDevices();
+    if (m_readySyncs > 0 && --m_readySyncs == 0)
+    {
+        setReady(true);
+    }
+    else if (m_readySyncs > 0)
+    {
+        requestSync();
+    }
+}
+
+void PipeWireController::coreError(uint32_t id, int seq, int res, const char *message)
+{
+    if (id == PW_ID_CORE && res == -EPIPE)
+    {
+        LOG_ERROR("PipeWire connection lost, reconnecting in " << RECONNECT_DELAY_MS << " ms");
+        clearCache();
+        const QList<PendingOperation *> pending = m_pending.values();
+        for (PendingOperation *operation : pending)
+        {
+            finishOperation(operation, false);
+        }
+        // The core is torn down from the timer, not from within its own callback
+        armTimer(m_reconnectTimer, RECONNECT_DELAY_MS);
+        return;
+    }
+
+    LOG_WARN("PipeWire error on object " << id << ": " << message << " (" << spa_strerror(res) << ")");
+    for (PendingOperation *operation : std::as_const(m_pending))
+    {
+        if (operation->proxyId == id)
+        {
+            operation->failed = true;
+        }
+    }
+}
+
+void PipeWireController::registryGlobal(uint32_t id, const char *type, const spa_dict *props)
+{
+    const char *mediaClass = props ? spa_dict_lookup(props, PW_KEY_MEDIA_CLASS) : nullptr;
+
+    if (std::strcmp(type, PW_TYPE_INTERFACE_Device) == 0 && mediaClass && std::strcmp(mediaClass, "Audio/Device") == 0)
+    {
+        auto *proxy = static_cast<pw_device *>(pw_registry_bind(m_registry, id, type, PW_VERSION_DEVICE, 0));
+        auto device = std::make_unique<Device>(Device{this, id, proxy, QString::fromUtf8(spa_dict_lookup(props, PW_KEY_DEVICE_NAME))});
+        pw_device_add_listener(proxy, &device->listener, &DEVICE_EVENTS, device.get());
+        pw_device_subscribe_params(proxy, const_cast<uint32_t *>(DEVICE_PARAMS), SPA_N_ELEMENTS(DEVICE_PARAMS));
+        device->dirty = true;
+        m_devices[id] = std::move(device);
+        requestSync();
+    }
+    else if (std::strcmp(type, PW_TYPE_INTERFACE_Node) == 0 && mediaClass && std::strcmp(mediaClass, "Audio/Sink") == 0)
+    {
+        auto *proxy = static_cast<pw_node *>(pw_registry_bind(m_registry, id, type, PW_VERSION_NODE, 0));
+        auto node = std::make_unique<Node>(Node{this, id, proxy, QString::fromUtf8(spa_dict_lookup(props, PW_KEY_NODE_NAME))});
+        pw_node_add_listener(proxy, &node->listener, &NODE_EVENTS, node.get());
+        pw_node_subscribe_params(proxy, const_cast<uint32_t *>(NODE_PARAMS), SPA_N_ELEMENTS(NODE_PARAMS));
+        updateSink(id, Sink{node->name, -1});
+        m_nodes[id] = std::move(node);
+    }
+    else if (std::strcmp(type, PW_TYPE_INTERFACE_Metadata) == 0 && !m_metadata && props)
+    {
+        const char *metadataName = spa_dict_lookup(props, "metadata.name");
+        if (metadataName && std::strcmp(metadataName, "default") == 0)
+        {
+            m_metadata = static_cast<pw_metadata *>(pw_registry_bind(m_registry, id, type, PW_VERSION_METADATA, 0));
+            pw_metadata_add_listener(m_metadata, &m_metadataListener, &METADATA_EVENTS, this);
+        }
+    }
+}
+
+void PipeWireController::registryGlobalRemove(uint32_t id)
+{
+    if (auto it = m_devices.find(id); it != m_devices.end())
+    {
+        spa_hook_remove(&it->second->listener);
+        pw_proxy_destroy(reinterpret_cast<pw_proxy *>(it->second->proxy));
+        m_devices.erase(it);
+        removeCard(id);
+    }
+    else if (auto it = m_nodes.find(id); it != m_nodes.end())
+    {
+        spa_hook_remove(&it->second->listener);
+        pw_proxy_destroy(reinterpret_cast<pw_proxy *>(it->second->proxy));
+        m_nodes.erase(it);
+        removeSink(id);
+    }
+}
+
+void PipeWireController::deviceInfo(Device *device, const pw_device_info *info)
+{
+    if (!(info->change_mask & PW_DEVICE_CHANGE_MASK_PARAMS))
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < info->n_params; i++)
+    {
+        // The profile list changed as a whole, e.g. codecs came and went; read it again from scratch
+        if (info->params[i].id == SPA_PARAM_EnumProfile && info->params[i].user > 0)
+        {
+            device->profiles.clear();
+            pw_device_enum_params(device->proxy, 0, SPA_PARAM_EnumProfile, 0, UINT32_MAX, nullptr);
+            device->dirty = true;
+            requestSync();
+        }
+    }
+}
+
+void PipeWireController::deviceParam(Device *device, uint32_t paramId, const spa_pod *param)
+{
+    int32_t index = -1;
+    const char *name = nullptr;
+    int32_t priority = 0;
+    uint32_t available = SPA_PARAM_AVAILABILITY_unknown;
+
+    switch (paramId)
+    {
+    case SPA_PARAM_EnumProfile:
+        if (spa_pod_parse_object(param, SPA_TYPE_OBJECT_ParamProfile, nullptr, SPA_PARAM_PROFILE_index,
+                                 SPA_POD_Int(&index), SPA_PARAM_PROFILE_name, SPA_POD_String(&name),
+                                 SPA_PARAM_PROFILE_priority, SPA_POD_OPT_Int(&priority),
+                                 SPA_PARAM_PROFILE_available, SPA_POD_OPT_Id(&available))
+            < 0)
+        {
+            return;
+        }
+        device->profiles.insert(index, {QString::fromUtf8(name), static_cast<quint32>(qMax(priority, 0)),
+                                        available != SPA_PARAM_AVAILABILITY_no});
+        break;
+    case SPA_PARAM_Profile:
+        if (spa_pod_parse_object(param, SPA_TYPE_OBJECT_ParamProfile, nullptr, SPA_PARAM_PROFILE_index,
+                                 SPA_POD_Int(&index))
+            < 0)
+        {
+            return;
+        }
+        device->activeProfile = index;
+        break;
+    default:
+        return;
+    }
+
+    // Params arrive one by one, the card is published once at the next sync
+    device->dirty = true;
+    requestSync();
+}
+
+void PipeWireController::nodeParam(Node *node, uint32_t paramId, const spa_pod *param)
+{
+    if (paramId != SPA_PARAM_Props || !spa_pod_is_object_type(param, SPA_TYPE_OBJECT_Props))
+    {
+        return;
+    }
+    const auto *object = reinterpret_cast<const spa_pod_object *>(param);
+    const spa_pod_prop *prop;
+    SPA_POD_OBJECT_FOREACH(object, prop)
+    {
+        if (prop->key != SPA_PROP_channelVolumes)
+        {
+            continue;
+        }
+        float volumes[SPA_AUDIO_MAX_CHANNELS];
+        const uint32_t count = spa_pod_copy_array(&prop->value, SPA_TYPE_Float, volumes, SPA_AUDIO_MAX_CHANNELS);
+        if (count == 0)
+        {
+            return;
+        }
+        float sum = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            sum += volumes[i];
+        }
+        node->channels = count;
+        updateSink(node->id, Sink{node->name, volumeToPercent(sum / count)});
+        return;
+    }
+}
+
+int PipeWireController::metadataProperty(uint32_t subject, const char *key, const char *value)
+{
+    if (subject != PW_ID_CORE)
+    {
+        return 0;
+    }
+    // A null key clears all properties
+    if (!key || std::strcmp(key, "default.audio.sink") == 0)
+    {
+        const QJsonObject object = value ? QJsonDocument::fromJson(QByteArray(value)).object() : QJsonObject();
+        setDefaultSink(object.value("name").toString());
+    }
+    return 0;
+}
+
+QFuture<bool> PipeWireController::startOperation(const char *description, int timeoutMs,
+                                                 const std::function<pw_proxy *(const char **error)> &request)
+{
+    auto *pending = new PendingOperation{this, description};
+    pending->promise.start();
+    QFuture<bool> future = pending->promise.future();
+
+    pw_thread_loop_lock(m_loop);
+    m_pending.insert(pending);
+    const char *error = "PipeWire is not connected";
+    pw_proxy *proxy = m_core ? request(&error) : nullptr;
+    if (!proxy)
+    {
+        LOG_ERROR("Cannot " << description << ": " << error);
+        finishOperation(pending, false);
+    }
+    else
+    {
+        pending->proxyId = pw_proxy_get_id(proxy);
+        pending->seq = pw_core_sync(m_core, PW_ID_CORE, 0);
+        pending->timeout = pw_loop_add_timer(
+            pw_thread_loop_get_loop(m_loop),
+            [](void *data, uint64_t) {
+                PendingOperation *pending = static_cast<PendingOperation *>(data);
+                LOG_WARN("PipeWire did not answer in time to " << pending->description);
+                pending->controller->finishOperation(pending, false);
+            },
+            pending);
+        armTimer(pending->timeout, timeoutMs);
+    }
+    pw_thread_loop_unlock(m_loop);
+
+    return future;
+}
+
+void PipeWireController::finishOperation(PendingOperation *pending, bool success)
+{
+    if (pending->timeout)
+    {
+        pw_loop_destroy_source(pw_thread_loop_get_loop(m_loop), pending->timeout);
+    }
+    pending->promise.addResult(success);
+    pending->promise.finish();
+    m_pending.remove(pending);
+    delete pending;
+}
+
+QFuture<bool> PipeWireController::setSinkVolume(const QString &sinkName, int volumePercent, int timeoutMs)
+{
+    return startOperation("set sink volume", timeoutMs, [this, sinkName, volumePercent](const char **error) -> pw_proxy * {
+        for (auto &entry : m_nodes)
+        {
+            Node *node = entry.second.get();
+            if (node->name != sinkName)
+            {
+                continue;
+            }
+            float volumes[SPA_AUDIO_MAX_CHANNELS];
+            for (uint32_t i = 0; i < node->channels; i++)
+            {
+                volumes[i] = percentToVolume(volumePercent);
+            }
+            uint8_t buffer[512];
+            spa_pod_builder builder;
+            spa_pod_builder_init(&builder, buffer, sizeof(buffer));
+            auto *param = static_cast<const spa_pod *>(spa_pod_builder_add_object(
+                &builder, SPA_TYPE_OBJECT_Props, SPA_PARAM_Props, SPA_PROP_channelVolumes,
+                SPA_POD_Array(sizeof(float), SPA_TYPE_Float, node->channels, volumes)));
+            pw_node_set_param(node->proxy, SPA_PARAM_Props, 0, param);
+            return reinterpret_cast<pw_proxy *>(node->proxy);
+        }
+        *error = "no such sink";
+        return nullptr;
+    });
+}
+
+QFuture<bool> PipeWireController::setCardProfile(const QString &cardName, const QString &profileName, int timeoutMs)
+{
+    return startOperation("set card profile", timeoutMs, [this, cardName, profileName](const char **error) -> pw_proxy * {
+        for (auto &entry : m_devices)
+        {
+            Device *device = entry.second.get();
+            if (device->name != cardName)
+            {
+                continue;
+            }
+            for (auto it = device->profiles.cbegin(); it != device->profiles.cend(); ++it)
+            {
+                if (it.value().name != profileName)
+                {
+                    continue;
+                }
+                uint8_t buffer[256];
+                spa_pod_builder builder;
+                spa_pod_builder_init(&builder, buffer, sizeof(buffer));
+                auto *param = static_cast<const spa_pod *>(spa_pod_builder_add_object(
+                    &builder, SPA_TYPE_OBJECT_ParamProfile, SPA_PARAM_Profile, SPA_PARAM_PROFILE_index,
+                    SPA_POD_Int(it.key()), SPA_PARAM_PROFILE_save, SPA_POD_Bool(true)));
+                pw_device_set_param(device->proxy, SPA_PARAM_Profile, 0, param);
+                return reinterpret_cast<pw_proxy *>(device->proxy);
+            }
+            *error = "no such profile";
+            return nullptr;
+        }
+        *error = "no such card";
+        return nullptr;
+    });
+}
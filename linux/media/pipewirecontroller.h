@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QMap>
+#include <QSet>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <pipewire/pipewire.h>
+#include <pipewire/extensions/metadata.h>
+#include "audiobackend.h"
+
+/**
+ * @brief AudioBackend on libpipewire, without the pulse compatibility layer.
+ *
+ * Tracks Audio/Device and Audio/Sink globals from the registry and the
+ * "default" metadata on a pw_thread_loop. Card profiles come from the
+ * EnumProfile/Profile params of the device and are switched by setting
+ * SPA_PARAM_Profile, volumes are the channelVolumes of the sink node. A change
+ * finishes at the core sync that follows it, unless the server reported an
+ * error for the object in between.
+ */
+class PipeWireController : public AudioBackend
+{
+    Q_OBJECT
+
+public:
+    static constexpr int RECONNECT_DELAY_MS = 1000;
+
+    explicit PipeWireController(QObject *parent = nullptr);
+    ~PipeWireController() override;
+
+    bool initialize() override;
+    const char *name() const override { return "PipeWire"; }
+
+    QFuture<bool> setSinkVolume(const QString &sinkName, int volumePercent,
+                                int timeoutMs = DEFAULT_TIMEOUT_MS) override;
+    QFuture<bool> setCardProfile(const QString &cardName, const QString &profileName,
+                                 int timeoutMs = DEFAULT_TIMEOUT_MS) override;
+
+private:
+    struct Device;
+    struct Node;
+    struct PendingOperation;
+
+    static const pw_core_events CORE_EVENTS;
+    static const pw_registry_events REGISTRY_EVENTS;
+    static const pw_device_events DEVICE_EVENTS;
+    static const pw_node_events NODE_EVENTS;
+    static const pw_metadata_events METADATA_EVENTS;
+
+    pw_thread_loop *m_loop = nullptr;
+    pw_context *m_context = nullptr;
+    pw_core *m_core = nullptr;
+    pw_registry *m_registry = nullptr;
+    pw_metadata *m_metadata = nullptr; // The "default" metadata, holds the default sink
+    spa_hook m_coreListener{};
+    spa_hook m_registryListener{};
+    spa_hook m_metadataListener{};
+    spa_source *m_reconnectTimer = nullptr;
+
+    // Everything below is only touched with the loop locked
+    std::unordered_map<uint32_t, std::unique_ptr<Device>> m_devices; // Keyed by global id
+    std::unordered_map<uint32_t, std::unique_ptr<Node>> m_nodes;
+    QSet<PendingOperation *> m_pending;
+    int m_syncSeq = -1;      // Sync after which changed devices are published, -1 if none pending
+    int m_readySyncs = 0;    // Syncs left until the first complete picture of the graph
+
+    bool connectCore();
+    void teardownCore();
+    void armTimer(spa_source *timer, int ms);
+    void requestSync();
+    void publishDevices();
+
+    void coreDone(uint32_t id, int seq);
+    void coreError(uint32_t id, int seq, int res, const char *message);
+    void registryGlobal(uint32_t id, const char *type, const spa_dict *props);
+    void registryGlobalRemove(uint32_t id);
+    void deviceInfo(Device *device, const pw_device_info *info);
+    void deviceParam(Device *device, uint32_t paramId, const spa_pod *param);
+    void nodeParam(Node *node, uint32_t paramId, const spa_pod *param);
+    int metadataProperty(uint32_t subject, const char *key, const char *value);
+
+    QFuture<bool> startOperation(const char *description, int timeoutMs,
+                                 const std::function<pw_proxy *(const char **error)> &request);
+    void finishOperation(PendingOperation *pending, bool success);
+};
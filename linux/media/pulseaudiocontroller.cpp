@@ -1,14 +1,47 @@
 #include "pulseaudiocontroller.h"
 #include "logger.h"
-#include <QThread>
+#include <QPromise>
+#include <pulse/rtclock.h>
+#include <pulse/timeval.h>
+
+struct PulseAudioController::PendingOperation
+{
+    PulseAudioController *controller;
+    const char *description; // What failed, e.g. "set card profile"
+    QPromise<bool> promise;
+    pa_operation *op = nullptr;
+    pa_time_event *timeout = nullptr;
+};
 
 PulseAudioController::PulseAudioController(QObject *parent)
-    : QObject(parent), m_mainloop(nullptr), m_context(nullptr), m_initialized(false)
+    : AudioBackend(parent), m_mainloop(nullptr), m_context(nullptr)
 {
 }
 
 PulseAudioController::~PulseAudioController()
 {
+    // Stop first so no callback runs while everything goes away
+    if (m_mainloop)
+    {
+        pa_threaded_mainloop_stop(m_mainloop);
+    }
+    for (PendingOperation *pending : std::as_const(m_pending))
+    {
+        // Futures still waiting end up cancelled
+        if (pending->timeout)
+        {
+            m_api->time_free(pending->timeout);
+        }
+        if (pending->op)
+        {
+            pa_operation_unref(pending->op);
+        }
+        delete pending;
+    }
+    if (m_reconnectEvent)
+    {
+        m_api->time_free(m_reconnectEvent);
+    }
     if (m_context)
     {
         pa_context_disconnect(m_context);
@@ -16,7 +49,6 @@ PulseAudioController::~PulseAudioController()
     }
     if (m_mainloop)
     {
-        pa_threaded_mainloop_stop(m_mainloop);
         pa_threaded_mainloop_free(m_mainloop);
     }
 }
@@ -29,269 +61,288 @@ bool PulseAudioController::initialize()
         LOG_ERROR("Failed to create PulseAudio mainloop");
         return false;
     }
+    m_api = pa_threaded_mainloop_get_api(m_mainloop);
 
-    pa_mainloop_api *api = pa_threaded_mainloop_get_api(m_mainloop);
-    m_context = pa_context_new(api, "LibrePods");
-    if (!m_context)
+    if (!connectContext())
     {
-        LOG_ERROR("Failed to create PulseAudio context");
         return false;
     }
-
-    pa_context_set_state_callback(m_context, contextStateCallback, this);
-    
     if (pa_threaded_mainloop_start(m_mainloop) < 0)
     {
         LOG_ERROR("Failed to start PulseAudio mainloop");
         return false;
     }
+    return true;
+}
 
-    pa_threaded_mainloop_lock(m_mainloop);
-    
-    if (pa_context_connect(m_context, nullptr, PA_CONTEXT_NOFLAGS, nullptr) < 0)
+bool PulseAudioController::connectContext()
+{
+    m_context = pa_context_new(m_api, "LibrePods");
+    if (!m_context)
     {
-        LOG_ERROR("Failed to connect to PulseAudio");
-        pa_threaded_mainloop_unlock(m_mainloop);
+        LOG_ERROR("Failed to create PulseAudio context");
         return false;
     }
 
-    // Wait for context to be ready
-    while (pa_context_get_state(m_context) != PA_CONTEXT_READY)
+    pa_context_set_state_callback(m_context, contextStateCallback, this);
+    pa_context_set_subscribe_callback(m_context, subscribeCallback, this);
+
+    // NOFAIL waits for a server that is not running yet instead of failing
+    if (pa_context_connect(m_context, nullptr, PA_CONTEXT_NOFAIL, nullptr) < 0)
     {
-        if (!PA_CONTEXT_IS_GOOD(pa_context_get_state(m_context)))
-        {
-            LOG_ERROR("PulseAudio context failed");
-            pa_threaded_mainloop_unlock(m_mainloop);
-            return false;
-        }
-        pa_threaded_mainloop_wait(m_mainloop);
+        LOG_ERROR("Failed to connect to PulseAudio: " << pa_strerror(pa_context_errno(m_context)));
+        return false;
     }
-
-    pa_threaded_mainloop_unlock(m_mainloop);
-    m_initialized = true;
-    LOG_INFO("PulseAudio controller initialized");
     return true;
 }
 
 void PulseAudioController::contextStateCallback(pa_context *c, void *userdata)
 {
     PulseAudioController *controller = static_cast<PulseAudioController*>(userdata);
-    pa_threaded_mainloop_signal(controller->m_mainloop, 0);
-}
-
-QString PulseAudioController::getDefaultSink()
-{
-    if (!m_initialized) return QString();
-
-    struct CallbackData {
-        QString sinkName;
-        pa_threaded_mainloop *mainloop;
-    } data;
-    data.mainloop = m_mainloop;
+    if (c != controller->m_context)
+    {
+        return;
+    }
 
-    auto callback = [](pa_context *c, const pa_server_info *info, void *userdata) {
-        CallbackData *d = static_cast<CallbackData*>(userdata);
-        if (info && info->default_sink_name)
+    switch (pa_context_get_state(c))
+    {
+    case PA_CONTEXT_READY:
+    {
+        // Subscribe before the initial queries so no change falls in between
+        const auto mask = static_cast<pa_subscription_mask_t>(PA_SUBSCRIPTION_MASK_SERVER | PA_SUBSCRIPTION_MASK_SINK
+                                                              | PA_SUBSCRIPTION_MASK_CARD);
+        controller->releaseOperation(pa_context_subscribe(c, mask, nullptr, nullptr));
+
+        // Fill the cache once, everything after this comes from events. Requests are answered in
+        // order, so the card list is the last to arrive.
+        controller->releaseOperation(pa_context_get_server_info(c, serverInfoCallback, controller));
+        controller->releaseOperation(pa_context_get_sink_info_list(c, sinkInfoCallback, controller));
+        controller->releaseOperation(pa_context_get_card_info_list(
+            c,
+            [](pa_context *c, const pa_card_info *info, int eol, void *userdata) {
+                PulseAudioController *controller = static_cast<PulseAudioController *>(userdata);
+                if (eol == 0)
+                {
+                    cardInfoCallback(c, info, eol, userdata);
+                    return;
+                }
+                controller->setReady(true);
+            },
+            controller));
+        break;
+    }
+    case PA_CONTEXT_FAILED:
+    {
+        LOG_ERROR("PulseAudio connection lost: " << pa_strerror(pa_context_errno(c)) << ", reconnecting in "
+                  << RECONNECT_DELAY_MS << " ms");
+        controller->clearCache();
+        const QList<PendingOperation *> pending = controller->m_pending.values();
+        for (PendingOperation *operation : pending)
         {
-            d->sinkName = QString::fromUtf8(info->default_sink_name);
+            controller->finishOperation(operation, false);
         }
-        pa_threaded_mainloop_signal(d->mainloop, 0);
-    };
 
-    pa_threaded_mainloop_lock(m_mainloop);
-    pa_operation *op = pa_context_get_server_info(m_context, callback, &data);
-    if (op)
-    {
-        waitForOperation(op);
-        pa_operation_unref(op);
+        struct timeval tv;
+        pa_timeval_rtstore(&tv, pa_rtclock_now() + RECONNECT_DELAY_MS * PA_USEC_PER_MSEC, true);
+        controller->m_reconnectEvent = controller->m_api->time_new(controller->m_api, &tv, reconnectCallback,
+                                                                   controller);
+        break;
     }
-    pa_threaded_mainloop_unlock(m_mainloop);
+    default:
+        break;
+    }
+}
+
+void PulseAudioController::reconnectCallback(pa_mainloop_api *api, pa_time_event *e, const struct timeval *tv,
+                                             void *userdata)
+{
+    PulseAudioController *controller = static_cast<PulseAudioController*>(userdata);
+    api->time_free(e);
+    controller->m_reconnectEvent = nullptr;
 
-    return data.sinkName;
+    pa_context_unref(controller->m_context);
+    controller->m_context = nullptr;
+    controller->connectContext();
 }
 
-int PulseAudioController::getSinkVolume(const QString &sinkName)
+void PulseAudioController::subscribeCallback(pa_context *c, pa_subscription_event_type_t type, uint32_t index,
+                                             void *userdata)
 {
-    if (!m_initialized) return -1;
-
-    struct CallbackData {
-        int volume;
-        QString targetSink;
-        pa_threaded_mainloop *mainloop;
-    } data;
-    data.volume = -1;
-    data.targetSink = sinkName;
-    data.mainloop = m_mainloop;
-
-    auto callback = [](pa_context *c, const pa_sink_info *info, int eol, void *userdata) {
-        CallbackData *d = static_cast<CallbackData*>(userdata);
-        if (eol > 0)
+    PulseAudioController *controller = static_cast<PulseAudioController*>(userdata);
+    const auto facility = type & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+    const bool removed = (type & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE;
+
+    switch (facility)
+    {
+    case PA_SUBSCRIPTION_EVENT_SERVER:
+        controller->releaseOperation(pa_context_get_server_info(c, serverInfoCallback, controller));
+        break;
+    case PA_SUBSCRIPTION_EVENT_SINK:
+        if (removed)
+        {
+            controller->removeSink(index);
+        }
+        else
+        {
+            controller->releaseOperation(pa_context_get_sink_info_by_index(c, index, sinkInfoCallback, controller));
+        }
+        break;
+    case PA_SUBSCRIPTION_EVENT_CARD:
+        if (removed)
         {
-            pa_threaded_mainloop_signal(d->mainloop, 0);
-            return;
+            controller->removeCard(index);
         }
-        if (info && QString::fromUtf8(info->name) == d->targetSink)
+        else
         {
-            d->volume = (pa_cvolume_avg(&info->volume) * 100) / PA_VOLUME_NORM;
-            pa_threaded_mainloop_signal(d->mainloop, 0);
+            controller->releaseOperation(pa_context_get_card_info_by_index(c, index, cardInfoCallback, controller));
         }
-    };
+        break;
+    default:
+        break;
+    }
+}
 
-    pa_threaded_mainloop_lock(m_mainloop);
-    pa_operation *op = pa_context_get_sink_info_by_name(m_context, sinkName.toUtf8().constData(), callback, &data);
-    if (op)
+void PulseAudioController::serverInfoCallback(pa_context *c, const pa_server_info *info, void *userdata)
+{
+    PulseAudioController *controller = static_cast<PulseAudioController*>(userdata);
+    if (info)
     {
-        waitForOperation(op);
-        pa_operation_unref(op);
+        controller->setDefaultSink(QString::fromUtf8(info->default_sink_name));
     }
-    pa_threaded_mainloop_unlock(m_mainloop);
-
-    return data.volume;
 }
 
-bool PulseAudioController::setSinkVolume(const QString &sinkName, int volumePercent)
+void PulseAudioController::sinkInfoCallback(pa_context *c, const pa_sink_info *info, int eol, void *userdata)
 {
-    if (!m_initialized) return false;
+    PulseAudioController *controller = static_cast<PulseAudioController*>(userdata);
+    if (eol != 0 || !info)
+    {
+        return;
+    }
 
-    pa_cvolume volume;
-    pa_cvolume_set(&volume, 2, (volumePercent * PA_VOLUME_NORM) / 100);
+    Sink sink;
+    sink.name = QString::fromUtf8(info->name);
+    sink.volumePercent = static_cast<int>((static_cast<quint64>(pa_cvolume_avg(&info->volume)) * 100) / PA_VOLUME_NORM);
+    controller->updateSink(info->index, sink);
+}
 
-    pa_threaded_mainloop_lock(m_mainloop);
-    
-    auto successCallback = [](pa_context *c, int success, void *userdata) {
-        pa_threaded_mainloop *mainloop = static_cast<pa_threaded_mainloop*>(userdata);
-        pa_threaded_mainloop_signal(mainloop, 0);
-    };
-    
-    pa_operation *op = pa_context_set_sink_volume_by_name(m_context, sinkName.toUtf8().constData(), &volume, successCallback, m_mainloop);
-
-    bool success = waitForOperation(op);
-    if (op) pa_operation_unref(op);
-    pa_threaded_mainloop_unlock(m_mainloop);
+void PulseAudioController::cardInfoCallback(pa_context *c, const pa_card_info *info, int eol, void *userdata)
+{
+    PulseAudioController *controller = static_cast<PulseAudioController*>(userdata);
+    if (eol != 0 || !info)
+    {
+        return;
+    }
 
-    return success;
+    CardSnapshot card;
+    card.name = QString::fromUtf8(info->name);
+    if (info->active_profile2)
+    {
+        card.activeProfile = QString::fromUtf8(info->active_profile2->name);
+    }
+    card.profiles.reserve(info->n_profiles);
+    for (uint32_t i = 0; i < info->n_profiles; i++)
+    {
+        const pa_card_profile_info2 *profile = info->profiles2[i];
+        card.profiles.append({QString::fromUtf8(profile->name), profile->priority,
+                              profile->available != PA_CARD_PROFILE_AVAILABLE_NO});
+    }
+    controller->updateCard(info->index, card);
 }
 
-bool PulseAudioController::setCardProfile(const QString &cardName, const QString &profileName)
+void PulseAudioController::operationCallback(pa_context *c, int success, void *userdata)
 {
-    if (!m_initialized) return false;
-
-    pa_threaded_mainloop_lock(m_mainloop);
-    
-    auto successCallback = [](pa_context *c, int success, void *userdata) {
-        pa_threaded_mainloop *mainloop = static_cast<pa_threaded_mainloop*>(userdata);
-        pa_threaded_mainloop_signal(mainloop, 0);
-    };
-    
-    pa_operation *op = pa_context_set_card_profile_by_name(m_context, 
-        cardName.toUtf8().constData(), 
-        profileName.toUtf8().constData(), 
-        successCallback, m_mainloop);
-    bool success = waitForOperation(op);
-    if (op) pa_operation_unref(op);
-    pa_threaded_mainloop_unlock(m_mainloop);
+    PendingOperation *pending = static_cast<PendingOperation *>(userdata);
+    if (!success)
+    {
+        LOG_ERROR("PulseAudio failed to " << pending->description << ": " << pa_strerror(pa_context_errno(c)));
+    }
+    pending->controller->finishOperation(pending, success);
+}
 
-    return success;
+void PulseAudioController::operationTimeoutCallback(pa_mainloop_api *api, pa_time_event *e, const struct timeval *tv,
+                                                    void *userdata)
+{
+    PendingOperation *pending = static_cast<PendingOperation *>(userdata);
+    LOG_WARN("PulseAudio did not answer in time to " << pending->description);
+    // A cancelled operation does not call back, so the promise is finished only here
+    pa_operation_cancel(pending->op);
+    pending->controller->finishOperation(pending, false);
 }
 
-QString PulseAudioController::getCardNameForDevice(const QString &macAddress)
+QFuture<bool> PulseAudioController::startOperation(const char *description, int timeoutMs, const Request &request)
 {
-    if (!m_initialized) return QString();
-
-    struct CallbackData {
-        QString cardName;
-        QString targetMac;
-        pa_threaded_mainloop *mainloop;
-    } data;
-    data.targetMac = macAddress;
-    data.mainloop = m_mainloop;
-
-    auto callback = [](pa_context *c, const pa_card_info *info, int eol, void *userdata) {
-        CallbackData *d = static_cast<CallbackData*>(userdata);
-        if (eol > 0)
-        {
-            pa_threaded_mainloop_signal(d->mainloop, 0);
-            return;
-        }
-        if (info)
-        {
-            QString name = QString::fromUtf8(info->name);
-            if (name.startsWith("bluez") && name.contains(d->targetMac))
-            {
-                d->cardName = name;
-                pa_threaded_mainloop_signal(d->mainloop, 0);
-            }
-        }
-    };
+    auto *pending = new PendingOperation{this, description};
+    pending->promise.start();
+    QFuture<bool> future = pending->promise.future();
 
     pa_threaded_mainloop_lock(m_mainloop);
-    pa_operation *op = pa_context_get_card_info_list(m_context, callback, &data);
-    if (op)
+    m_pending.insert(pending);
+    if (m_context && pa_context_get_state(m_context) == PA_CONTEXT_READY)
+    {
+        pending->op = request(m_context, operationCallback, pending);
+    }
+    if (pending->op)
     {
-        waitForOperation(op);
-        pa_operation_unref(op);
+        pending->timeout = pa_context_rttime_new(m_context, pa_rtclock_now() + timeoutMs * PA_USEC_PER_MSEC,
+                                                 operationTimeoutCallback, pending);
+    }
+    else
+    {
+        LOG_ERROR("Cannot " << description << ": PulseAudio is not connected");
+        finishOperation(pending, false);
     }
     pa_threaded_mainloop_unlock(m_mainloop);
 
-    return data.cardName;
+    return future;
 }
 
-bool PulseAudioController::isProfileAvailable(const QString &cardName, const QString &profileName)
+void PulseAudioController::finishOperation(PendingOperation *pending, bool success)
 {
-    if (!m_initialized) return false;
-
-    struct CallbackData {
-        bool available;
-        QString targetCard;
-        QString targetProfile;
-        pa_threaded_mainloop *mainloop;
-    } data;
-    data.available = false;
-    data.targetCard = cardName;
-    data.targetProfile = profileName;
-    data.mainloop = m_mainloop;
-
-    auto callback = [](pa_context *c, const pa_card_info *info, int eol, void *userdata) {
-        CallbackData *d = static_cast<CallbackData*>(userdata);
-        if (eol > 0)
-        {
-            pa_threaded_mainloop_signal(d->mainloop, 0);
-            return;
-        }
-        if (info && QString::fromUtf8(info->name) == d->targetCard)
-        {
-            for (uint32_t i = 0; i < info->n_profiles; i++)
-            {
-                if (QString::fromUtf8(info->profiles[i].name) == d->targetProfile)
-                {
-                    d->available = true;
-                    break;
-                }
-            }
-            pa_threaded_mainloop_signal(d->mainloop, 0);
-        }
-    };
-
-    pa_threaded_mainloop_lock(m_mainloop);
-    pa_operation *op = pa_context_get_card_info_by_name(m_context, cardName.toUtf8().constData(), callback, &data);
-    if (op)
+    if (pending->timeout)
     {
-        waitForOperation(op);
-        pa_operation_unref(op);
+        m_api->time_free(pending->timeout);
     }
-    pa_threaded_mainloop_unlock(m_mainloop);
+    if (pending->op)
+    {
+        pa_operation_unref(pending->op);
+    }
+    pending->promise.addResult(success);
+    pending->promise.finish();
+    m_pending.remove(pending);
+    delete pending;
+}
 
-    return data.available;
+QFuture<bool> PulseAudioController::setSinkVolume(const QString &sinkName, int volumePercent, int timeoutMs)
+{
+    pa_cvolume volume;
+    pa_cvolume_set(&volume, 2, (volumePercent * PA_VOLUME_NORM) / 100);
+    const QByteArray name = sinkName.toUtf8();
+
+    return startOperation("set sink volume", timeoutMs,
+                          [name, volume](pa_context *c, pa_context_success_cb_t callback, void *userdata) {
+                              return pa_context_set_sink_volume_by_name(c, name.constData(), &volume, callback,
+                                                                        userdata);
+                          });
 }
 
-bool PulseAudioController::waitForOperation(pa_operation *op)
+QFuture<bool> PulseAudioController::setCardProfile(const QString &cardName, const QString &profileName, int timeoutMs)
 {
-    if (!op) return false;
+    const QByteArray card = cardName.toUtf8();
+    const QByteArray profile = profileName.toUtf8();
+
+    return startOperation("set card profile", timeoutMs,
+                          [card, profile](pa_context *c, pa_context_success_cb_t callback, void *userdata) {
+                              return pa_context_set_card_profile_by_name(c, card.constData(), profile.constData(),
+                                                                         callback, userdata);
+                          });
+}
 
-    while (pa_operation_get_state(op) == PA_OPERATION_RUNNING)
+void PulseAudioController::releaseOperation(pa_operation *op)
+{
+    if (!op)
     {
-        pa_threaded_mainloop_wait(m_mainloop);
+        LOG_ERROR("PulseAudio request failed: " << pa_strerror(pa_context_errno(m_context)));
+        return;
     }
-
-    return pa_operation_get_state(op) == PA_OPERATION_DONE;
+    pa_operation_unref(op);
 }
@@ -1,37 +1,60 @@
 #ifndef PULSEAUDIOCONTROLLER_H
 #define PULSEAUDIOCONTROLLER_H
 
-#include <QString>
-#include <QObject>
+#include <QSet>
+#include <functional>
 #include <pulse/pulseaudio.h>
-
-class PulseAudioController : public QObject
+#include "audiobackend.h"
+
+/**
+ * @brief AudioBackend on libpulse, for PulseAudio and pipewire-pulse.
+ *
+ * Runs a threaded mainloop, subscribes to server, sink and card events and
+ * reconnects when the server goes away.
+ */
+class PulseAudioController : public AudioBackend
 {
     Q_OBJECT
 
 public:
+    static constexpr int RECONNECT_DELAY_MS = 1000; // After pipewire-pulse went away
+
     explicit PulseAudioController(QObject *parent = nullptr);
-    ~PulseAudioController();
+    ~PulseAudioController() override;
+
+    bool initialize() override;
+    const char *name() const override { return "PulseAudio"; }
 
-    bool initialize();
-    QString getDefaultSink();
-    int getSinkVolume(const QString &sinkName);
-    bool setSinkVolume(const QString &sinkName, int volumePercent);
-    bool setCardProfile(const QString &cardName, const QString &profileName);
-    QString getCardNameForDevice(const QString &macAddress);
-    bool isProfileAvailable(const QString &cardName, const QString &profileName);
+    QFuture<bool> setSinkVolume(const QString &sinkName, int volumePercent,
+                                int timeoutMs = DEFAULT_TIMEOUT_MS) override;
+    QFuture<bool> setCardProfile(const QString &cardName, const QString &profileName,
+                                 int timeoutMs = DEFAULT_TIMEOUT_MS) override;
 
 private:
+    struct PendingOperation;
+    using Request = std::function<pa_operation *(pa_context *, pa_context_success_cb_t, void *)>;
+
     pa_threaded_mainloop *m_mainloop;
+    pa_mainloop_api *m_api = nullptr;
     pa_context *m_context;
-    bool m_initialized;
+    pa_time_event *m_reconnectEvent = nullptr;
+    QSet<PendingOperation *> m_pending; // Only touched with the mainloop locked
+
+    bool connectContext();
+    QFuture<bool> startOperation(const char *description, int timeoutMs, const Request &request);
+    void finishOperation(PendingOperation *pending, bool success);
 
     static void contextStateCallback(pa_context *c, void *userdata);
+    static void subscribeCallback(pa_context *c, pa_subscription_event_type_t type, uint32_t index, void *userdata);
     static void sinkInfoCallback(pa_context *c, const pa_sink_info *info, int eol, void *userdata);
     static void cardInfoCallback(pa_context *c, const pa_card_info *info, int eol, void *userdata);
     static void serverInfoCallback(pa_context *c, const pa_server_info *info, void *userdata);
+    static void operationCallback(pa_context *c, int success, void *userdata);
+    static void operationTimeoutCallback(pa_mainloop_api *api, pa_time_event *e, const struct timeval *tv,
+                                         void *userdata);
+    static void reconnectCallback(pa_mainloop_api *api, pa_time_event *e, const struct timeval *tv, void *userdata);
 
-    bool waitForOperation(pa_operation *op);
+    void releaseOperation(pa_operation *op);
 };
 
 #endif // PULSEAUDIOCONTROLLER_H
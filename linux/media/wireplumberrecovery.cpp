@@ -0,0 +1,180 @@
+#include "wireplumberrecovery.h"
+#include "logger.h"
+#include "audiobackend.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+
+WirePlumberRecovery::WirePlumberRecovery(AudioBackend *audio, QObject *parent)
+    : QObject(parent), m_audio(audio)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, [this]()
+    {
+        if (m_state == State::Backoff)
+        {
+            nextAttempt();
+        }
+        else if (m_state == State::WaitingForCard)
+        {
+            retryOrFail("card did not come back with an A2DP profile");
+        }
+    });
+    connect(m_audio, &AudioBackend::cardChanged, this, &WirePlumberRecovery::checkCard);
+}
+
+void WirePlumberRecovery::start(BluetoothAddress address)
+{
+    if (isRunning())
+    {
+        return;
+    }
+    m_address = address;
+    m_attempt = 0;
+    ++m_stats.recoveries;
+    m_elapsed.start();
+    LOG_INFO("Recovering A2DP profiles for " << address);
+    nextAttempt();
+}
+
+void WirePlumberRecovery::cancel()
+{
+    if (!isRunning())
+    {
+        return;
+    }
+    LOG_INFO("WirePlumber recovery cancelled in state " << m_state);
+    m_timer.stop();
+    m_state = State::Idle;
+    ++m_run;
+}
+
+void WirePlumberRecovery::nextAttempt()
+{
+    ++m_attempt;
+    ++m_stats.attempts;
+
+    // The card may have recovered on its own, or only the profile change failed last time
+    const QString cardName = m_audio->getCardNameForDevice(m_address);
+    const QString profile = selectA2dpProfile(m_audio->getCardSnapshot(cardName));
+    if (!profile.isEmpty())
+    {
+        activate(cardName, profile);
+    }
+    else
+    {
+        restartUnit();
+    }
+}
+
+void WirePlumberRecovery::restartUnit()
+{
+    LOG_INFO("Restarting " << UNIT_NAME << ", attempt " << m_attempt << " of " << MAX_ATTEMPTS);
+    m_state = State::Restarting;
+
+    QDBusMessage message = QDBusMessage::createMethodCall("org.freedesktop.systemd1", "/org/freedesktop/systemd1",
+                                                          "org.freedesktop.systemd1.Manager", "RestartUnit");
+    message << QString::fromLatin1(UNIT_NAME) << QStringLiteral("replace");
+    auto *watcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, run = m_run](QDBusPendingCallWatcher *watcher)
+    {
+        QDBusPendingReply<QDBusObjectPath> reply = *watcher;
+        watcher->deleteLater();
+        if (run != m_run || m_state != State::Restarting)
+        {
+            return;
+        }
+        if (reply.isError())
+        {
+            retryOrFail("RestartUnit failed: " + reply.error().message());
+            return;
+        }
+        LOG_DEBUG("Restart job queued: " << reply.value().path());
+        m_state = State::WaitingForCard;
+        m_timer.start(CARD_TIMEOUT_MS);
+    });
+}
+
+void WirePlumberRecovery::checkCard(const QString &cardName)
+{
+    // Cards seen while systemd is still restarting the unit count as well
+    if ((m_state != State::Restarting && m_state != State::WaitingForCard)
+        || AudioBackend::bluezDeviceAddress(cardName) != m_address)
+    {
+        return;
+    }
+    const QString profile = selectA2dpProfile(m_audio->getCardSnapshot(cardName));
+    if (!profile.isEmpty())
+    {
+        m_timer.stop();
+        activate(cardName, profile);
+    }
+}
+
+void WirePlumberRecovery::activate(const QString &cardName, const QString &profile)
+{
+    LOG_INFO("Activating " << profile << " on " << cardName);
+    m_state = State::Activating;
+    m_audio->setCardProfile(cardName, profile).then(this, [this, run = m_run, cardName, profile](bool success)
+    {
+        if (run != m_run || m_state != State::Activating)
+        {
+            return;
+        }
+        if (success)
+        {
+            finish(true, cardName, profile);
+        }
+        else
+        {
+            retryOrFail("could not activate " + profile);
+        }
+    });
+}
+
+void WirePlumberRecovery::retryOrFail(const QString &reason)
+{
+    if (m_attempt >= MAX_ATTEMPTS)
+    {
+        LOG_ERROR("WirePlumber recovery gave up: " << reason);
+        finish(false);
+        return;
+    }
+    const int delay = INITIAL_BACKOFF_MS << (m_attempt - 1);
+    LOG_WARN("WirePlumber recovery attempt " << m_attempt << " failed: " << reason << ", retrying in " << delay
+             << " ms");
+    m_state = State::Backoff;
+    m_timer.start(delay);
+}
+
+void WirePlumberRecovery::finish(bool success, const QString &cardName, const QString &profile)
+{
+    m_timer.stop();
+    m_state = State::Idle;
+    ++m_run;
+
+    m_stats.lastLatencyMs = m_elapsed.elapsed();
+    if (success)
+    {
+        ++m_stats.succeeded;
+    }
+    else
+    {
+        ++m_stats.failed;
+    }
+    LOG_INFO("WirePlumber recovery " << (success ? "succeeded" : "failed") << " after " << m_attempt
+             << " attempts in " << m_stats.lastLatencyMs << " ms (" << m_stats.succeeded << " of "
+             << m_stats.recoveries << " recoveries succeeded so far)");
+
+    if (success)
+    {
+        emit recovered(cardName, profile);
+    }
+    else
+    {
+        emit failed();
+    }
+}
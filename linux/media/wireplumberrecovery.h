@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include "bluetoothaddress.h"
+
+class AudioBackend;
+
+/**
+ * @brief Brings back the A2DP profiles of a card by restarting WirePlumber.
+ *
+ * Restarts the session manager through the systemd user manager on D-Bus,
+ * waits for the card to come back with an A2DP profile through the audio
+ * backend's card events and activates the profile. Failed steps are retried with
+ * exponential backoff, bounded by MAX_ATTEMPTS. Nothing here blocks.
+ */
+class WirePlumberRecovery : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class State
+    {
+        Idle,
+        Restarting,     // RestartUnit sent, waiting for systemd
+        WaitingForCard, // Waiting for the card to show an A2DP profile
+        Activating,     // Card profile change sent
+        Backoff,        // Waiting before the next attempt
+    };
+    Q_ENUM(State)
+
+    struct Stats
+    {
+        int recoveries = 0;
+        int succeeded = 0;
+        int failed = 0;
+        int attempts = 0;
+        qint64 lastLatencyMs = -1; // From start() to the outcome of the last recovery
+    };
+
+    static constexpr int MAX_ATTEMPTS = 3;
+    static constexpr int CARD_TIMEOUT_MS = 5000;
+    static constexpr int INITIAL_BACKOFF_MS = 1000; // Doubled after every failed attempt
+    static constexpr const char *UNIT_NAME = "wireplumber.service";
+
+    explicit WirePlumberRecovery(AudioBackend *audio, QObject *parent = nullptr);
+
+    // Starts recovering the card of the device, does nothing while a recovery is running
+    void start(BluetoothAddress address);
+    void cancel();
+
+    State state() const { return m_state; }
+    bool isRunning() const { return m_state != State::Idle; }
+    const Stats &stats() const { return m_stats; }
+
+signals:
+    void recovered(const QString &cardName, const QString &profile);
+    void failed();
+
+private:
+    void nextAttempt();
+    void restartUnit();
+    void activate(const QString &cardName, const QString &profile);
+    void checkCard(const QString &cardName);
+    void retryOrFail(const QString &reason);
+    void finish(bool success, const QString &cardName = QString(), const QString &profile = QString());
+
+    AudioBackend *m_audio;
+    QTimer m_timer; // Card timeout or backoff, depending on the state
+    QElapsedTimer m_elapsed;
+    BluetoothAddress m_address;
+    State m_state = State::Idle;
+    int m_attempt = 0;
+    quint64 m_run = 0; // Tells replies of a cancelled recovery from the current one
+    Stats m_stats;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+/**
+ * @brief Publishes a trivially copyable value to reader threads without locks.
+ *
+ * Readers copy the value and retry if a write overlapped the copy, so they
+ * never block writers or each other. Writers on different threads take turns by
+ * claiming the odd sequence number. The value is held in atomic words so an
+ * overlapped copy is never a data race.
+ */
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Values are copied word by word");
+
+public:
+    SeqLock() { writeWords(T{}); }
+    explicit SeqLock(const T &value) { writeWords(value); }
+
+    T load() const
+    {
+        quint64 generation;
+        return load(&generation);
+    }
+
+    // Copies the value and reports the generation it was published in
+    T load(quint64 *generation) const
+    {
+        T value;
+        for (;;)
+        {
+            const quint64 before = m_sequence.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                std::this_thread::yield(); // A writer is mid-update
+                continue;
+            }
+            readWords(value);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == before)
+            {
+                *generation = before >> 1;
+                return value;
+            }
+        }
+    }
+
+    // Number of published changes so far
+    quint64 generation() const { return m_sequence.load(std::memory_order_acquire) >> 1; }
+
+    bool store(const T &value)
+    {
+        return update([&value](T &current) { current = value; });
+    }
+
+    /**
+     * @brief Modifies the value in place while other writers wait
+     * @param fn Called with the current value
+     * @return true if fn changed the value; otherwise no new generation is published
+     */
+    template <typename Fn>
+    bool update(Fn &&fn)
+    {
+        quint64 sequence = m_sequence.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if (sequence & 1)
+            {
+                std::this_thread::yield();
+                sequence = m_sequence.load(std::memory_order_relaxed);
+            }
+            else if (m_sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire,
+                                                      std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        // Word stores must not become visible before the odd sequence number
+        std::atomic_thread_fence(std::memory_order_release);
+
+        T previous;
+        readWords(previous);
+        T value = previous;
+        fn(value);
+
+        const bool changed = std::memcmp(&previous, &value, sizeof(T)) != 0;
+        if (changed)
+        {
+            writeWords(value);
+        }
+        // Readers that overlapped an unchanged update saw the same words, so the old number is restored
+        m_sequence.store(changed ? sequence + 2 : sequence, std::memory_order_release);
+        return changed;
+    }
+
+private:
+    static constexpr std::size_t WORDS = (sizeof(T) + sizeof(quint64) - 1) / sizeof(quint64);
+
+    void readWords(T &value) const
+    {
+        quint64 words[WORDS];
+        for (std::size_t i = 0; i < WORDS; ++i)
+        {
+            words[i] = m_words[i].load(std::memory_order_relaxed);
+        }
+        std::memcpy(&value, words, sizeof(T));
+    }
+
+    void writeWords(const T &value)
+    {
+        quint64 words[WORDS] = {};
+        std::memcpy(words, &value, sizeof(T));
+        for (std::size_t i = 0; i < WORDS; ++i)
+        {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    alignas(64) std::atomic<quint64> m_sequence{0}; // Odd while a writer is mid-update
+    std::array<std::atomic<quint64>, WORDS> m_words{};
+};
@@ -8,6 +8,9 @@
 #include <QFont>
 #include <QColor>
 #include <QActionGroup>
+#include <QGuiApplication>
+#include <QPalette>
+#include <QStyleHints>
 
 using namespace AirpodsTrayApp::Enums;
 
@@ -23,6 +26,9 @@ TrayIconManager::TrayIconManager(QObject *parent) : QObject(parent)
     // Connect signals
     trayIcon->setContextMenu(trayMenu);
     connect(trayIcon, &QSystemTrayIcon::activated, this, &TrayIconManager::onTrayIconActivated);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    connect(QGuiApplication::styleHints(), &QStyleHints::colorSchemeChanged, this, &TrayIconManager::updateIcon);
+#endif
 
     trayIcon->show();
 }
@@ -36,8 +42,36 @@ void TrayIconManager::showNotification(const QString &title, const QString &mess
 
 void TrayIconManager::TrayIconManager::updateBatteryStatus(const QString &status)
 {
-    trayIcon->setToolTip("Battery Status: " + status);
-    updateIconFromBattery(status);
+    m_batteryStatus = status;
+    updateToolTip();
+}
+
+void TrayIconManager::updateBatteryLevel(int level, bool charging)
+{
+    m_level = qBound(NO_LEVEL, level, 100);
+    m_charging = charging;
+    updateIcon();
+}
+
+void TrayIconManager::updateBatteryEstimate(const QString &estimate)
+{
+    m_batteryEstimate = estimate;
+    updateToolTip();
+}
+
+void TrayIconManager::updateToolTip()
+{
+    if (m_batteryStatus.isEmpty())
+    {
+        trayIcon->setToolTip("");
+        return;
+    }
+    QString toolTip = "Battery Status: " + m_batteryStatus;
+    if (!m_batteryEstimate.isEmpty())
+    {
+        toolTip += "\n" + m_batteryEstimate;
+    }
+    trayIcon->setToolTip(toolTip);
 }
 
 void TrayIconManager::updateNoiseControlState(NoiseControlMode mode)
@@ -105,35 +139,46 @@ void TrayIconManager::setupMenuActions()
     connect(quitAction, &QAction::triggered, qApp, &QApplication::quit);
 }
 
-void TrayIconManager::updateIconFromBattery(const QString &status)
+void TrayIconManager::updateIcon()
 {
-    int leftLevel = 0;
-    int rightLevel = 0;
-    int minLevel = 0;
+    if (m_level == NO_LEVEL)
+    {
+        return;
+    }
+    const bool darkTheme = QGuiApplication::palette().color(QPalette::Window).lightness() < 128;
+    const int key = iconKey(m_level, m_charging, darkTheme);
+    if (key == m_iconKey)
+    {
+        return;
+    }
 
-    if (!status.isEmpty())
+    auto it = m_iconCache.constFind(key);
+    if (it == m_iconCache.cend())
     {
-        // Parse the battery status string
-        QStringList parts = status.split(", ");
-        if (parts.size() >= 2) {
-            leftLevel = parts[0].split(": ")[1].replace("%", "").toInt();
-            rightLevel = parts[1].split(": ")[1].replace("%", "").toInt();
-            minLevel = (leftLevel == 0) ? rightLevel : (rightLevel == 0) ? leftLevel
-                                                                    : qMin(leftLevel, rightLevel);
-        } else if (parts.size() == 1) {
-            minLevel = parts[0].split(": ")[1].replace("%", "").toInt();
-        }
+        it = m_iconCache.insert(key, renderIcon(m_level, m_charging, darkTheme));
     }
+    m_iconKey = key;
+    trayIcon->setIcon(*it);
+}
+
+int TrayIconManager::iconKey(int level, bool charging, bool darkTheme)
+{
+    return level | (charging ? 1 << 7 : 0) | (darkTheme ? 1 << 8 : 0);
+}
 
+QIcon TrayIconManager::renderIcon(int level, bool charging, bool darkTheme)
+{
     QPixmap pixmap(32, 32);
     pixmap.fill(Qt::transparent);
     QPainter painter(&pixmap);
-    painter.setPen(Qt::white);
+    if (charging)
+        painter.setPen(QColor("#30D158"));
+    else
+        painter.setPen(darkTheme ? Qt::white : Qt::black);
     painter.setFont(QFont("Arial", 12, QFont::Bold));
-    painter.drawText(pixmap.rect(), Qt::AlignCenter, QString::number(minLevel) + "%");
+    painter.drawText(pixmap.rect(), Qt::AlignCenter, QString::number(level) + "%");
     painter.end();
-
-    trayIcon->setIcon(QIcon(pixmap));
+    return QIcon(pixmap);
 }
 
 void TrayIconManager::onTrayIconActivated(QSystemTrayIcon::ActivationReason reason)
@@ -1,3 +1,5 @@
+#include <QHash>
+#include <QIcon>
 #include <QObject>
 #include <QSystemTrayIcon>
 
@@ -15,8 +17,15 @@ class TrayIconManager : public QObject
 public:
     explicit TrayIconManager(QObject *parent = nullptr);
 
+    // Tooltip text, e.g. "Left: 80%, Right: 75%, Case: 60%"
     void updateBatteryStatus(const QString &status);
 
+    // Level shown in the icon; the icon is only replaced when level, charging or theme differ
+    void updateBatteryLevel(int level, bool charging);
+
+    // Second tooltip line, e.g. "About 3 h 20 min left"
+    void updateBatteryEstimate(const QString &estimate);
+
     void updateNoiseControlState(AirpodsTrayApp::Enums::NoiseControlMode);
 
     void updateConversationalAwareness(bool enabled);
@@ -35,6 +44,10 @@ public:
 
     void resetTrayIcon()
     {
+        m_batteryStatus.clear();
+        m_batteryEstimate.clear();
+        m_level = NO_LEVEL;
+        m_iconKey = NO_LEVEL;
         trayIcon->setIcon(QIcon(":/icons/assets/airpods.png"));
         trayIcon->setToolTip("");
     }
@@ -50,11 +63,22 @@ private:
     QMenu *trayMenu;
     QAction *caToggleAction;
     QActionGroup *noiseControlGroup;
+    static constexpr int NO_LEVEL = -1; // The AirPods icon is shown
+
     bool m_notificationsEnabled = true;
+    QString m_batteryStatus;
+    QString m_batteryEstimate;
+    int m_level = NO_LEVEL;
+    bool m_charging = false;
+    int m_iconKey = NO_LEVEL;      // Key of the icon currently set
+    QHash<int, QIcon> m_iconCache; // Rendered on first use, keyed by iconKey()
 
     void setupMenuActions();
 
-    void updateIconFromBattery(const QString &status);
+    void updateIcon();
+    static int iconKey(int level, bool charging, bool darkTheme);
+    static QIcon renderIcon(int level, bool charging, bool darkTheme);
+    void updateToolTip();
 
 signals:
     void trayClicked();